@@ -0,0 +1,109 @@
+#include "AsyncSolver.hpp"
+
+AsyncSolver::AsyncSolver(unsigned int n_workers) : T{ std::make_shared<TranspositionTable>() }, stopping{ false } {
+    running.resize(std::max(1u, n_workers), std::stop_source(std::nostopstate));
+    for (unsigned int i = 0; i < std::max(1u, n_workers); i++)
+        workers.emplace_back(&AsyncSolver::worker, this, i);
+}
+
+AsyncSolver::~AsyncSolver() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    cancel_all();
+    cv.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+AsyncSolver::Handle AsyncSolver::submit(const Position& P, Progress progress, std::stop_token caller_stop) {
+    Job job{ P, std::move(progress), {}, std::move(caller_stop), {} };
+    Handle handle{ job.result.get_future(), job.stop };
+    {
+        std::lock_guard<std::mutex> lock(m);
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+    return handle;
+}
+
+void AsyncSolver::cancel_all() {
+    std::deque<Job> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(m);
+        cancelled.swap(jobs);
+        for (std::stop_source& s : running) s.request_stop();
+    }
+    for (Job& job : cancelled) job.result.set_value(Result{ true, 0, 0 });
+}
+
+void AsyncSolver::worker(size_t index) {
+    Solver S(T);
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+            running[index] = job.stop;
+        }
+
+        Result r{ true, 0, 0 };
+        {
+            std::stop_callback forward(job.caller_stop, [&] { job.stop.request_stop(); });
+            if (!job.stop.stop_requested()) {
+                S.stop = job.stop.get_token();
+                S.on_window = job.progress;
+                unsigned long long nodes_before = S.nodeCount;
+                r.score = S.solve(job.P);
+                r.nodes = S.nodeCount - nodes_before;
+                r.cancelled = S.stop.stop_requested();
+                S.stop = std::stop_token();
+                S.on_window = nullptr;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(m);
+            running[index] = std::stop_source(std::nostopstate);
+        }
+        job.result.set_value(r);
+    }
+}
+
+void AsyncSolver::cancel_test(const std::string& filename, unsigned int n_workers, std::chrono::microseconds cancel_after, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return;
+
+    AsyncSolver A(n_workers);
+    auto clock = std::chrono::steady_clock();
+    std::vector<long long> latencies; // from cancel() to the result, in microseconds
+    std::atomic<unsigned long long> n_progress{ 0 };
+    for (const std::string& moves : positions) {
+        Handle h = A.submit(Position(moves), [&](int, int) { n_progress++; });
+        if (h.result.wait_for(cancel_after) == std::future_status::ready) continue;
+        auto t1 = clock.now();
+        h.cancel();
+        h.result.get();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    strm << latencies.size() << "/" << positions.size() << " solves cancelled after " << cancel_after.count() << " us, "
+         << n_progress << " progress calls";
+    if (!latencies.empty())
+        strm << ", time to cancel: p50 " << latencies[latencies.size() / 2] << " us, max " << latencies.back() << " us";
+    strm << "\n";
+
+    std::vector<Handle> handles;
+    for (const std::string& moves : positions) handles.push_back(A.submit(Position(moves)));
+    int n_mismatches = 0;
+    auto t1 = clock.now();
+    for (size_t i = 0; i < handles.size(); i++) {
+        Result r = handles[i].result.get();
+        n_mismatches += r.cancelled || r.score != expected[i];
+    }
+    strm << "solved again on the same table with " << n_workers << " workers: " << std::chrono::duration<double>(clock.now() - t1).count() << "s"
+         << (n_mismatches ? ", MISMATCHES: " + std::to_string(n_mismatches) : ", no mismatch") << "\n";
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <vector>
+#include "Solver.hpp"
+
+/**
+* Non-blocking solves. submit() queues a position and returns at once with a Handle holding the future result;
+* a pool of worker threads, each with its own Solver sharing one TranspositionTable, runs the searches.
+*
+* A solve is cancelled through the stop_source of its Handle (or all of them with cancel_all, when the position
+* they were solved for is stale). A queued job is dropped without searching, a running one is abandoned at the next
+* node: negamax unwinds without storing anything, so the shared table only ever holds proven bounds.
+*/
+class AsyncSolver {
+public:
+	struct Result {
+		bool cancelled; // score is meaningless if the solve was cancelled
+		int score;
+		unsigned long long nodes;
+	};
+
+	// Called from the worker thread after each null-window search, with the bounds of the score proven so far
+	typedef std::function<void(int min, int max)> Progress;
+
+	struct Handle {
+		std::future<Result> result;
+		std::stop_source stop;
+		void cancel() { stop.request_stop(); }
+	};
+
+	AsyncSolver(unsigned int n_workers);
+	~AsyncSolver(); // cancels the pending solves
+
+	// Solve P (moves may include a winning move). Also cancelled when 'caller_stop' is requested, if given.
+	Handle submit(const Position& P, Progress progress = nullptr, std::stop_token caller_stop = {});
+
+	// Cancel every queued and running solve
+	void cancel_all();
+
+	// Submit every line of a test file and cancel each solve after 'cancel_after' if not done. Report how long the
+	// cancelled solves took to return, then solve the file again on the same table to check that it is still sound.
+	static void cancel_test(const std::string& filename, unsigned int n_workers, std::chrono::microseconds cancel_after, std::ostream& strm);
+
+private:
+	struct Job {
+		Position P;
+		Progress progress;
+		std::stop_source stop;
+		std::stop_token caller_stop;
+		std::promise<Result> result;
+	};
+
+	std::shared_ptr<TranspositionTable> T;
+	std::vector<std::thread> workers;
+	std::deque<Job> jobs;
+	std::vector<std::stop_source> running; // stop sources of the jobs being solved, one per worker
+	std::mutex m;
+	std::condition_variable cv;
+	bool stopping;
+
+	void worker(size_t index);
+};
@@ -0,0 +1,132 @@
+#include <numeric>
+#include "BatchSolver.hpp"
+
+BatchSolver::BatchSolver(unsigned int n_workers) : n_workers{ std::max(1u, n_workers) }, prefix_order{ false }, end_of_file{ false }, n_read{ 0 }, n_written{ 0 } {}
+
+std::vector<size_t> BatchSolver::trie_order(const std::vector<std::string_view>& moves) {
+    // Of a line and its mirror image, the smaller string is the one whose first move off the center column is on the
+    // left, so lines that share a prefix up to symmetry share it after this too. Sorting the strings then walks their trie.
+    std::vector<std::string> keys(moves.size());
+    for (size_t i = 0; i < moves.size(); i++) {
+        std::string mirrored(moves[i]);
+        for (char& c : mirrored) c = char('1' + Position::WIDTH - 1 - (c - '1'));
+        keys[i] = std::min(std::string(moves[i]), mirrored);
+    }
+    std::vector<size_t> order(moves.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+    return order;
+}
+
+void BatchSolver::worker() {
+    Solver S; // constructed on the worker thread, so the tables are cleared in parallel
+    if (!snapshot.empty()) S.T->load(snapshot);
+    auto clock = std::chrono::steady_clock();
+
+    size_t chunk_next = 0, chunk_end = 0; // run of the planned order taken by this worker
+    while (true) {
+        Result* r;
+        if (prefix_order) {
+            if (chunk_next == chunk_end) {
+                std::lock_guard<std::mutex> lock(m);
+                chunk_next = n_read;
+                chunk_end = n_read = std::min(n_read + CHUNK, order.size());
+            }
+            if (chunk_next == chunk_end) break;
+            r = &results[order[chunk_next++]];
+        }
+        else {
+            std::unique_lock<std::mutex> lock(m);
+            space.wait(lock, [&] { return end_of_file || n_read < n_written + WINDOW; });
+            if (end_of_file) break;
+            r = &results[n_read % WINDOW];
+            if (!reader.next(r->moves, r->expected)) {
+                end_of_file = true;
+                done.notify_all();
+                space.notify_all();
+                break;
+            }
+            r->done = false;
+            n_read++;
+        }
+
+        auto t1 = clock.now();
+        unsigned long long nodes_before = S.nodeCount;
+
+        Position p(r->moves);
+        int score = S.alpha_beta(p);
+
+        auto n_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count();
+        {
+            std::lock_guard<std::mutex> lock(m);
+            r->score = score;
+            r->microseconds = n_microseconds;
+            r->nodes = S.nodeCount - nodes_before;
+            r->done = true;
+        }
+        done.notify_all();
+    }
+
+    std::lock_guard<std::mutex> lock(m);
+    totalStats += S.totalStats;
+}
+
+void BatchSolver::test_file(std::string filename, std::ostream& strm) {
+    if (!reader.open(filename)) return;
+
+    results.assign(WINDOW, Result{});
+    totalStats.reset();
+    end_of_file = false;
+    n_read = n_written = 0;
+
+    auto clock = std::chrono::steady_clock();
+    auto t1 = clock.now();
+
+    if (prefix_order) { // read everything, then plan
+        results.clear();
+        Result r{};
+        while (reader.next(r.moves, r.expected)) results.push_back(r);
+        std::vector<std::string_view> moves;
+        for (const Result& line : results) moves.push_back(line.moves);
+        order = trie_order(moves);
+        end_of_file = true;
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < n_workers; i++)
+        workers.emplace_back(&BatchSolver::worker, this);
+
+    // Write results in input order while the workers keep going
+    ResultWriter writer(strm);
+    long long total_positions = 0;
+    int n_mismatches = 0;
+    for (size_t i = 0; ; i++) {
+        std::unique_lock<std::mutex> lock(m);
+        if (prefix_order) {
+            if (i >= results.size()) break;
+            done.wait(lock, [&] { return results[i].done; });
+        }
+        else {
+            done.wait(lock, [&] { return (i < n_read && results[i % WINDOW].done) || (end_of_file && i >= n_read); });
+            if (i >= n_read) break;
+        }
+        Result r = results[prefix_order ? i : i % WINDOW];
+        n_written = i + 1;
+        lock.unlock();
+        space.notify_one();
+
+        writer.write(r.moves, r.microseconds, r.nodes);
+        total_positions += r.nodes;
+        if (r.score != r.expected) n_mismatches++;
+    }
+    writer.flush();
+
+    for (auto& t : workers) t.join();
+
+    auto wall_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count();
+    std::cout << "Total #Seconds: " << wall_microseconds / 1e6 << " (" << n_workers << " workers)\n";
+    std::cout << "Total #Positions: " << total_positions << "\n";
+    if (n_mismatches) std::cout << "Mismatched scores: " << n_mismatches << "\n";
+    if (reader.n_malformed) std::cout << "Malformed lines: " << reader.n_malformed << "\n";
+    totalStats.print(std::cout);
+}
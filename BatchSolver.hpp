@@ -0,0 +1,66 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include "Solver.hpp"
+#include "PositionFile.hpp"
+
+/**
+* Solves the lines of a test file on a pool of worker threads.
+*
+* Every worker owns its own Solver (and therefore its own TranspositionTable), so the
+* search itself is untouched. The file is streamed through a pipeline: a worker parses the
+* next line in place from the mapped file when it is free, solves it, and the calling thread
+* writes the results in input order, through a ResultWriter, as soon as they are available.
+* At most WINDOW lines are in flight between the reader and the writer, so memory does not
+* grow with the size of the file.
+*
+* With prefix_order, the whole file is read first and the lines are solved in the order of trie_order instead,
+* so that each worker finds in its table the subtrees of the lines it solved just before. Workers take the lines
+* in runs of CHUNK consecutive ones, and the results are still written in input order.
+*/
+class BatchSolver {
+public:
+	static constexpr size_t WINDOW = 1 << 12;
+	static constexpr size_t CHUNK = 64; // lines of the planned order taken at once by a worker
+
+	unsigned int n_workers;
+	std::string snapshot; // if set, every worker starts from this transposition table snapshot
+	bool prefix_order;    // solve the lines in the order of trie_order rather than in input order
+	SearchStats totalStats; // search counters summed over all workers
+
+	struct Result {
+		std::string_view moves; // points into the mapped file
+		int expected;
+		int score;
+		long long microseconds;
+		long long nodes; // negamax calls while solving this line
+		bool done;
+	};
+
+	BatchSolver(unsigned int n_workers);
+
+	// Same output format as Solver::test_file: "moves, microseconds, nodes" for each line
+	void test_file(std::string filename, std::ostream& strm);
+
+	// Order in which to solve a batch of lines (moves indexed from '1'): the depth-first order of the trie of their
+	// moves, each line mirrored if needed so that symmetric lines share their prefixes. A line comes right after the
+	// lines that share the longest prefix with it. Returns the indices of the lines in that order.
+	static std::vector<size_t> trie_order(const std::vector<std::string_view>& moves);
+
+private:
+	PositionReader reader;
+	bool end_of_file;
+	size_t n_read;    // lines handed to the workers
+	size_t n_written; // lines written, in input order
+	std::vector<Result> results; // line i is in results[i % WINDOW] from the time it is read until it is written
+	std::vector<size_t> order;   // with prefix_order, the lines in the order they are solved (results holds every line)
+	std::mutex m;
+	std::condition_variable done;  // a result is done, or the end of the file is reached
+	std::condition_variable space; // a line was written, so its slot is free
+
+	void worker();
+};
@@ -0,0 +1,480 @@
+#include <sstream>
+#include <iomanip>
+#include <numeric>
+#include "Benchmark.hpp"
+#include "MoveScorer.hpp"
+#include "BatchSolver.hpp"
+
+Benchmark::Latencies::Latencies(std::vector<long long> us) : total_us{ 0 } {
+    std::sort(us.begin(), us.end());
+    for (long long l : us) total_us += l;
+    auto percentile = [&](double p) { return us.empty() ? 0 : us[std::min(us.size() - 1, (size_t)(p * us.size()))]; };
+    p50_us = percentile(0.5);
+    p90_us = percentile(0.9);
+    p99_us = percentile(0.99);
+    max_us = us.empty() ? 0 : us.back();
+}
+
+std::ostream& operator<<(std::ostream& strm, const Benchmark::Latencies& l) {
+    return strm << "p50 " << l.p50_us << " us, p99 " << l.p99_us << " us, max " << l.max_us << " us";
+}
+
+bool Benchmark::run_file(const std::string& filename) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return false;
+    if (max_lines && positions.size() > max_lines) positions.resize(max_lines);
+
+    Solver S;
+    S.history.use_killers = use_killers;
+    S.history.use_history = use_history;
+    S.history.persist = persist_history;
+    S.make_unmake = make_unmake;
+    std::vector<long long> latencies;
+    LevelReport r{};
+    r.level = std::filesystem::path(filename).filename().string();
+    r.positions = positions.size();
+
+    std::vector<size_t> order(positions.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (prefix_order) order = BatchSolver::trie_order(std::vector<std::string_view>(positions.begin(), positions.end()));
+
+    auto clock = std::chrono::steady_clock();
+    for (size_t i : order) {
+        auto t1 = clock.now();
+        Position p(positions[i]);
+        int score = S.solve(p);
+        auto t2 = clock.now();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count());
+        r.seconds += std::chrono::duration<double>(t2 - t1).count();
+        if (score != expected[i]) r.mismatches++;
+    }
+
+    Latencies l(latencies);
+    r.p50_us = l.p50_us;
+    r.p90_us = l.p90_us;
+    r.p99_us = l.p99_us;
+    r.max_us = l.max_us;
+    r.nodes = S.nodeCount;
+    r.nodes_per_second = r.seconds > 0 ? r.nodes / r.seconds : 0;
+    r.stats = S.totalStats;
+    r.tt_hit_rate = S.totalStats.tt_probes ? (double)S.totalStats.tt_hits / S.totalStats.tt_probes : -1; // -1 without C4_SEARCH_STATS
+    reports.push_back(r);
+    return true;
+}
+
+void Benchmark::print(std::ostream& strm) const {
+    strm << std::left << std::setw(14) << "level" << std::right << std::setw(10) << "positions" << std::setw(12) << "seconds"
+         << std::setw(10) << "p50 us" << std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << std::setw(12) << "max us"
+         << std::setw(14) << "nodes" << std::setw(12) << "Mnodes/s" << std::setw(10) << "TT hits" << "\n";
+    for (const LevelReport& r : reports) {
+        strm << std::left << std::setw(14) << r.level << std::right << std::setw(10) << r.positions
+             << std::setw(12) << std::fixed << std::setprecision(3) << r.seconds
+             << std::setw(10) << r.p50_us << std::setw(10) << r.p90_us << std::setw(10) << r.p99_us << std::setw(12) << r.max_us
+             << std::setw(14) << r.nodes << std::setw(12) << std::setprecision(2) << r.nodes_per_second / 1e6;
+        if (r.tt_hit_rate < 0) strm << std::setw(10) << "n/a";
+        else strm << std::setw(9) << std::setprecision(1) << 100 * r.tt_hit_rate << "%";
+        strm << (r.mismatches ? "  MISMATCHES: " + std::to_string(r.mismatches) : "") << "\n";
+    }
+    strm.unsetf(std::ios::floatfield);
+    if (!SearchStats::enabled) strm << "TT hits are only counted in a build with -DC4_SEARCH_STATS=ON\n";
+
+    if (SearchStats::enabled) {
+        for (const LevelReport& r : reports) {
+            strm << "\n" << r.level << ":\n";
+            r.stats.print(strm);
+        }
+    }
+}
+
+static const char* CSV_HEADER = "level,positions,mismatches,seconds,p50_us,p90_us,p99_us,max_us,nodes,nodes_per_second,tt_hit_rate";
+
+bool Benchmark::write_csv(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cout << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    out << CSV_HEADER << "\n" << std::setprecision(10);
+    for (const LevelReport& r : reports)
+        out << r.level << "," << r.positions << "," << r.mismatches << "," << r.seconds << "," << r.p50_us << "," << r.p90_us << ","
+            << r.p99_us << "," << r.max_us << "," << r.nodes << "," << r.nodes_per_second << "," << r.tt_hit_rate << "\n";
+    return out.good();
+}
+
+bool Benchmark::write_json(const std::string& filename) const {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        std::cout << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    out << "{\n  \"levels\": [\n" << std::setprecision(10);
+    for (size_t i = 0; i < reports.size(); i++) {
+        const LevelReport& r = reports[i];
+        out << "    {\"level\": \"" << r.level << "\", \"positions\": " << r.positions << ", \"mismatches\": " << r.mismatches
+            << ", \"seconds\": " << r.seconds << ", \"p50_us\": " << r.p50_us << ", \"p90_us\": " << r.p90_us
+            << ", \"p99_us\": " << r.p99_us << ", \"max_us\": " << r.max_us << ", \"nodes\": " << r.nodes
+            << ", \"nodes_per_second\": " << r.nodes_per_second << ", \"tt_hit_rate\": " << r.tt_hit_rate << "}"
+            << (i + 1 < reports.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out.good();
+}
+
+bool Benchmark::read_csv(const std::string& filename, std::vector<LevelReport>& reports) {
+    std::ifstream in(filename);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line) || line.rfind(CSV_HEADER, 0) != 0) {
+        std::cout << "Failed to read baseline: " << filename << "\n";
+        return false;
+    }
+    while (std::getline(in, line)) {
+        std::stringstream ss(line);
+        LevelReport r{};
+        std::string field;
+        std::vector<std::string> fields;
+        while (std::getline(ss, field, ',')) fields.push_back(field);
+        if (fields.size() < 11) continue;
+        r.level = fields[0];
+        r.positions = std::stoull(fields[1]);
+        r.mismatches = std::stoi(fields[2]);
+        r.seconds = std::stod(fields[3]);
+        r.p50_us = std::stoll(fields[4]);
+        r.p90_us = std::stoll(fields[5]);
+        r.p99_us = std::stoll(fields[6]);
+        r.max_us = std::stoll(fields[7]);
+        r.nodes = std::stoull(fields[8]);
+        r.nodes_per_second = std::stod(fields[9]);
+        r.tt_hit_rate = std::stod(fields[10]);
+        reports.push_back(r);
+    }
+    return true;
+}
+
+int Benchmark::compare(const std::vector<LevelReport>& baseline, double threshold, std::ostream& strm) const {
+    int n_regressions = 0;
+    auto change = [](double now, double before) { return before > 0 ? now / before - 1 : 0; };
+    for (const LevelReport& r : reports) {
+        auto b = std::find_if(baseline.begin(), baseline.end(), [&](const LevelReport& x) { return x.level == r.level; });
+        if (b == baseline.end()) {
+            strm << r.level << ": not in baseline\n";
+            continue;
+        }
+        if (b->positions != r.positions) {
+            strm << r.level << ": baseline has " << b->positions << " positions, this run has " << r.positions << "\n";
+            continue;
+        }
+        double d_seconds = change(r.seconds, b->seconds);
+        double d_p99 = change((double)r.p99_us, (double)b->p99_us);
+        double d_nodes = change((double)r.nodes, (double)b->nodes);
+        bool regression = d_seconds > threshold || d_p99 > threshold || d_nodes > threshold || r.mismatches > b->mismatches;
+        n_regressions += regression;
+        strm << std::left << std::setw(14) << r.level << std::right << std::showpos << std::fixed << std::setprecision(1)
+             << " time " << std::setw(7) << 100 * d_seconds << "%"
+             << "  p50 " << std::setw(7) << 100 * change((double)r.p50_us, (double)b->p50_us) << "%"
+             << "  p99 " << std::setw(7) << 100 * d_p99 << "%"
+             << "  nodes " << std::setw(7) << 100 * d_nodes << "%"
+             << "  nodes/s " << std::setw(7) << 100 * change(r.nodes_per_second, b->nodes_per_second) << "%"
+             << std::noshowpos << (regression ? "  REGRESSION" : "") << "\n";
+    }
+    strm.unsetf(std::ios::floatfield);
+    return n_regressions;
+}
+
+void Benchmark::move_scoring(const std::vector<std::string>& filenames, std::ostream& strm) {
+    struct Node {
+        Position P;
+        board moves[MoveScorer::LANES];
+        int n;
+    };
+
+    // Every position along the test lines, with its non-losing moves in the default column order
+    std::vector<Node> nodes;
+    Solver S;
+    for (const std::string& filename : filenames) {
+        std::vector<std::string> positions;
+        std::vector<int> expected;
+        if (!Solver::read_test_file(filename, positions, expected)) return;
+        for (const std::string& moves : positions) {
+            Position P;
+            for (char c : moves) {
+                Node node{ P, {}, 0 };
+                if (!P.winning_moves()) {
+                    board possible = node.P.nonlosing_moves();
+                    for (int i = Position::WIDTH; i--; )
+                        if (board move = possible & Position::COL_MASK(S.columnOrder[i]))
+                            node.moves[node.n++] = move;
+                    if (node.n) nodes.push_back(node);
+                }
+                P.play_col(c - '1');
+            }
+        }
+    }
+    if (nodes.empty()) return;
+
+    const int REPEAT = std::max<size_t>(1, 20000000 / nodes.size());
+    std::vector<int> reference(nodes.size() * MoveScorer::LANES);
+    double scalar_ns = 0;
+    strm << nodes.size() << " nodes, " << REPEAT << " passes\n";
+    for (MoveScorer::Kernel k : { MoveScorer::Kernel::Scalar, MoveScorer::Kernel::AVX2, MoveScorer::Kernel::AVX512 }) {
+        strm << std::left << std::setw(8) << MoveScorer::name(k) << std::right;
+        if (!MoveScorer::supported(k)) {
+            strm << "  not supported by this CPU\n";
+            continue;
+        }
+        MoveScorer::Kernel saved = MoveScorer::kernel;
+        MoveScorer::kernel = k;
+        board threats[MoveScorer::LANES];
+        int scores[MoveScorer::LANES];
+        int mismatches = 0;
+        unsigned long long checksum = 0;
+        auto t1 = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPEAT; r++) {
+            for (size_t i = 0; i < nodes.size(); i++) {
+                const Node& node = nodes[i];
+                MoveScorer::score(node.P, node.moves, node.n, threats, scores);
+                for (int j = 0; j < node.n; j++) checksum += scores[j];
+                if (r == 0) {
+                    for (int j = 0; j < node.n; j++) {
+                        int& ref = reference[i * MoveScorer::LANES + j];
+                        if (k == MoveScorer::Kernel::Scalar) ref = scores[j];
+                        else mismatches += ref != scores[j];
+                    }
+                }
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t1).count() / ((double)REPEAT * nodes.size());
+        MoveScorer::kernel = saved;
+        if (k == MoveScorer::Kernel::Scalar) scalar_ns = ns;
+        strm << std::fixed << std::setprecision(2) << std::setw(8) << ns << " ns/node" << std::setw(8) << scalar_ns / ns << "x"
+             << "  (checksum " << checksum << ")" << (mismatches ? "  MISMATCHES: " + std::to_string(mismatches) : "") << "\n";
+        strm.unsetf(std::ios::floatfield);
+    }
+}
+
+void Benchmark::warm_start(const std::vector<std::string>& filenames, const std::string& snapshot, std::ostream& strm) {
+    std::vector<std::vector<std::string>> positions(filenames.size());
+    std::vector<std::vector<int>> expected(filenames.size());
+    for (size_t i = 0; i < filenames.size(); i++)
+        if (!Solver::read_test_file(filenames[i], positions[i], expected[i])) return;
+
+    auto clock = std::chrono::steady_clock();
+    auto run = [&](Solver& S, const char* name) {
+        for (size_t i = 0; i < filenames.size(); i++) {
+            unsigned long long nodes_before = S.nodeCount;
+            int n_mismatches = 0;
+            auto t1 = clock.now();
+            for (size_t j = 0; j < positions[i].size(); j++) {
+                Position p(positions[i][j]);
+                n_mismatches += S.alpha_beta(p) != expected[i][j];
+            }
+            strm << name << " " << filenames[i] << ": " << std::chrono::duration<double>(clock.now() - t1).count() << "s, "
+                 << S.nodeCount - nodes_before << " nodes" << (n_mismatches ? ", MISMATCHES: " + std::to_string(n_mismatches) : "") << "\n";
+        }
+    };
+
+    {
+        auto t1 = clock.now();
+        Solver S;
+        strm << "cold start: " << std::chrono::duration<double>(clock.now() - t1).count() << "s to allocate the table\n";
+        run(S, "cold");
+        t1 = clock.now();
+        if (!S.T->save(snapshot)) return;
+        strm << "saved " << S.T->bytes() / (1 << 20) << " MB in " << std::chrono::duration<double>(clock.now() - t1).count() << "s\n";
+    }
+    {
+        auto t1 = clock.now();
+        Solver S;
+        if (!S.T->load(snapshot)) return;
+        strm << "warm start: " << std::chrono::duration<double>(clock.now() - t1).count() << "s to allocate and load the table\n";
+        run(S, "warm");
+    }
+}
+
+void Benchmark::analyze(const std::string& filename, size_t max_lines, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return;
+    if (max_lines && positions.size() > max_lines) positions.resize(max_lines);
+
+    auto clock = std::chrono::steady_clock();
+    std::vector<Solver::Analysis> analyses(positions.size());
+    for (bool stop_at_best : { false, true }) {
+        Solver S;
+        S.T->clear(); // fault the table in, as the per-column run does before its timing starts
+        int n_mismatches = 0;
+        auto t1 = clock.now();
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position p(positions[i]);
+            Solver::Analysis A = S.analyze(p, stop_at_best);
+            n_mismatches += A.scores[A.best_col] != expected[i];
+            if (!stop_at_best) analyses[i] = A;
+        }
+        strm << (stop_at_best ? "analyze, stop at best move: " : "analyze: ") << std::chrono::duration<double>(clock.now() - t1).count()
+             << "s, " << S.nodeCount << " nodes" << (n_mismatches ? ", MISMATCHES: " + std::to_string(n_mismatches) : "") << "\n";
+    }
+    {
+        Solver S;
+        auto t1 = clock.now();
+        S.T->clear();
+        auto cleared = clock.now() - t1;
+        int n_different = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position p(positions[i]);
+            bool different = false;
+            for (int col = 0; col < Position::WIDTH; col++) {
+                board move = p.get_legal() & Position::COL_MASK(col);
+                int score = Solver::Analysis::INVALID;
+                if (move & p.winning_moves()) score = (Position::BOARD_SIZE + 1 - p.nb_moves) / 2;
+                else if (move) {
+                    auto t2 = clock.now();
+                    S.T->clear(); // every column starts cold, the clearing is not counted
+                    cleared += clock.now() - t2;
+                    Position child(p);
+                    child.play_move(move);
+                    score = -S.solve(child);
+                }
+                different |= score != analyses[i].scores[col];
+            }
+            n_different += different;
+        }
+        strm << "one solve per column: " << std::chrono::duration<double>(clock.now() - t1 - cleared).count() << "s, " << S.nodeCount << " nodes"
+             << (n_different ? ", DIFFERENT SCORES: " + std::to_string(n_different) : ", identical scores") << "\n";
+    }
+}
+
+void Benchmark::weak(const std::string& filename, size_t max_lines, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return;
+    if (max_lines && positions.size() > max_lines) positions.resize(max_lines);
+    if (positions.empty()) return;
+
+    auto clock = std::chrono::steady_clock();
+    double seconds[2];
+    unsigned long long nodes[2];
+    for (bool weak : { true, false }) {
+        Solver S;
+        S.T->clear(); // fault the table in before the timing starts
+        std::vector<long long> latencies;
+        int n_wrong = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position p(positions[i]);
+            auto t1 = clock.now();
+            int score = weak ? S.weak_solve(p) : S.solve(p);
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count());
+            n_wrong += weak ? score != (expected[i] > 0) - (expected[i] < 0) : score != expected[i];
+        }
+        Latencies l(latencies);
+        seconds[weak] = l.total_us / 1e6;
+        nodes[weak] = S.nodeCount;
+        strm << (weak ? "weak (win/draw/loss): " : "strong (exact score): ") << seconds[weak] << "s, " << nodes[weak] << " nodes, "
+             << l << (n_wrong ? ", WRONG: " + std::to_string(n_wrong) : "") << "\n";
+    }
+    strm << "weak / strong: " << seconds[1] / seconds[0] << " time, " << (double)nodes[1] / nodes[0] << " nodes\n";
+}
+
+void Benchmark::budget(const std::string& filename, unsigned long long max_nodes, std::chrono::microseconds max_time, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return;
+
+    Solver S;
+    auto clock = std::chrono::steady_clock();
+    std::vector<long long> latencies;
+    size_t n_exact = 0;
+    long long total_width = 0;
+    int n_wrong = 0;
+    for (size_t i = 0; i < positions.size(); i++) {
+        Position p(positions[i]);
+        auto t1 = clock.now();
+        Solver::BoundedScore r = S.alpha_beta_budget(p, max_nodes, max_time);
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count());
+        if (r.exact()) n_exact++;
+        else total_width += r.upper - r.lower;
+        n_wrong += expected[i] < r.lower || expected[i] > r.upper || r.best_col < 0;
+    }
+    if (latencies.empty()) return;
+
+    strm << filename << ": " << n_exact << "/" << positions.size() << " exact";
+    if (n_exact < positions.size()) strm << ", mean interval width of the others " << (double)total_width / (positions.size() - n_exact);
+    strm << ", " << Latencies(latencies) << (n_wrong ? ", WRONG INTERVALS: " + std::to_string(n_wrong) : "") << "\n";
+
+    // The table already holds the score of the root: the best move must still come from a search of the root
+    size_t n_warm_exact = 0;
+    int n_wrong_moves = 0;
+    Solver check; // scores of the children, on a table of its own
+    for (size_t i = 0; i < positions.size(); i++) {
+        Position p(positions[i]);
+        S.solve(p);
+        Solver::BoundedScore r = S.alpha_beta_budget(p, max_nodes, max_time);
+        if (!r.exact()) continue;
+        n_warm_exact++;
+        Position child(p);
+        child.play_col(r.best_col);
+        n_wrong_moves += r.lower != expected[i] || -check.solve(child) != expected[i];
+    }
+    strm << "  warm table: " << n_warm_exact << "/" << positions.size() << " exact"
+         << (n_wrong_moves ? ", WRONG BEST MOVES: " + std::to_string(n_wrong_moves) : ", every best move has the expected score") << "\n";
+}
+
+void Benchmark::dfpn(const std::string& filename, size_t max_lines, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return;
+    if (max_lines && positions.size() > max_lines) positions.resize(max_lines);
+
+    auto clock = std::chrono::steady_clock();
+    auto report = [&](const char* name, const std::vector<long long>& latencies, unsigned long long nodes, int n_wrong, int n_unknown) {
+        Latencies l(latencies);
+        strm << name << ": " << l.total_us / 1e6 << "s, " << nodes << " nodes, " << l << (n_unknown ? ", UNKNOWN: " + std::to_string(n_unknown) : "")
+             << (n_wrong ? ", WRONG: " + std::to_string(n_wrong) : "") << "\n";
+    };
+    if (positions.empty()) return;
+
+    {
+        DfpnSolver D;
+        std::vector<long long> latencies;
+        int n_wrong = 0, n_unknown = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position P(positions[i]);
+            auto t1 = clock.now();
+            DfpnSolver::Result r = D.prove_win(P);
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count());
+            n_unknown += r == DfpnSolver::Result::Unknown;
+            n_wrong += r != DfpnSolver::Result::Unknown && (r == DfpnSolver::Result::Proven) != (expected[i] > 0);
+        }
+        report("df-pn, win?", latencies, D.nodeCount, n_wrong, n_unknown);
+    }
+    {
+        Solver S;
+        std::vector<long long> latencies;
+        int n_wrong = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position P(positions[i]);
+            auto t1 = clock.now();
+            bool win = P.winning_moves();
+            if (!win) {
+                S.T->new_search();
+                S.history.clear();
+                win = S.negamax(P, 0, 1) > 0;
+            }
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count());
+            n_wrong += win != (expected[i] > 0);
+        }
+        report("null window, score > 0?", latencies, S.nodeCount, n_wrong, 0);
+    }
+    {
+        Solver S;
+        std::vector<long long> latencies;
+        int n_wrong = 0;
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position P(positions[i]);
+            auto t1 = clock.now();
+            int score = S.solve(P);
+            latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count());
+            n_wrong += score != expected[i];
+        }
+        report("alpha_beta, exact score", latencies, S.nodeCount, n_wrong, 0);
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <vector>
+#include "Solver.hpp"
+#include "Dfpn.hpp"
+
+/**
+* Benchmark over the test files: one report per file (level), with the latency distribution of
+* single positions, node throughput and transposition table hit rate.
+*
+* Reports can be written as CSV and JSON, and compared against a previous CSV report to catch regressions.
+* move_scoring() is a separate microbenchmark of the move ordering kernels. The other static functions are
+* harnesses that compare features of the 7x6 solver on the test files, and report to a stream.
+*/
+class Benchmark {
+public:
+	struct LevelReport {
+		std::string level;
+		size_t positions;
+		int mismatches;
+		double seconds;
+		long long p50_us, p90_us, p99_us, max_us;
+		unsigned long long nodes;
+		double nodes_per_second;
+		double tt_hit_rate;  // -1 if the search counters are disabled (see SearchStats)
+		SearchStats stats;   // only filled if SearchStats::enabled, not part of the CSV and JSON reports
+	};
+
+	// Summary of the latencies of single positions, in microseconds (all 0 without any)
+	struct Latencies {
+		long long total_us, p50_us, p90_us, p99_us, max_us;
+		explicit Latencies(std::vector<long long> us);
+	};
+
+	size_t max_lines = 0; // solve only the first max_lines positions of each file (0 for all)
+	bool use_killers = false;     // killer move ordering (see MoveHistory)
+	bool use_history = false;     // history move ordering
+	bool persist_history = false; // keep the killers and history from one position of a file to the next
+	bool make_unmake = true;      // search with in-place make/unmake rather than on copies of the positions
+	bool prefix_order = false;    // solve the positions in the order of BatchSolver::trie_order rather than in file order
+	std::vector<LevelReport> reports;
+
+	// Solve a test file with a fresh Solver and add its report
+	bool run_file(const std::string& filename);
+
+	void print(std::ostream& strm) const;
+	bool write_csv(const std::string& filename) const;
+	bool write_json(const std::string& filename) const;
+
+	static bool read_csv(const std::string& filename, std::vector<LevelReport>& reports);
+
+	// Print the change of each level against a baseline. A level regresses if its total time, p99 latency
+	// or node count grows by more than 'threshold' (relative). Returns the number of regressions.
+	int compare(const std::vector<LevelReport>& baseline, double threshold, std::ostream& strm) const;
+
+	// Microbenchmark of the MoveScorer kernels: score the candidate moves of every position along the lines of
+	// the test files with each kernel the CPU supports, check that they agree with the scalar kernel, and report
+	// the time per node
+	static void move_scoring(const std::vector<std::string>& filenames, std::ostream& strm);
+
+	// Solve the test files with a cold table and save it to 'snapshot', then solve them again with a fresh
+	// table loaded from the snapshot, and report both runs
+	static void warm_start(const std::vector<std::string>& filenames, const std::string& snapshot, std::ostream& strm);
+
+	// Score every column of the first max_lines positions of a test file (0 for all) with Solver::analyze, with and
+	// without stop_at_best, then with one solve per column on a cleared table. Report the runs and whether the scores agree.
+	static void analyze(const std::string& filename, size_t max_lines, std::ostream& strm);
+
+	// Solve the first max_lines positions of a test file (0 for all) with Solver::weak_solve, then with solve, each on
+	// a fresh table, and report the time, nodes and latency percentiles of both runs, and whether the outcomes agree
+	// with the signs of the expected scores
+	static void weak(const std::string& filename, size_t max_lines, std::ostream& strm);
+
+	// Solve a test file with Solver::alpha_beta_budget and report how many positions were solved exactly within the budget,
+	// the mean width of the intervals of the others, the latency percentiles and whether every interval holds the
+	// expected score. Then solve each position once more with solve and again with alpha_beta_budget on the warm table,
+	// and check that the best move returned there has the expected score
+	static void budget(const std::string& filename, unsigned long long max_nodes, std::chrono::microseconds max_time, std::ostream& strm);
+
+	// Prove or disprove every line of a test file with DfpnSolver::prove_win, and with a null-window search of alpha_beta
+	// (is the score above 0?), then solve it with alpha_beta. Report the time to proof of each, and whether the
+	// outcomes agree with the expected scores.
+	static void dfpn(const std::string& filename, size_t max_lines, std::ostream& strm);
+};
+
+// "p50 <us> us, p99 <us> us, max <us> us"
+std::ostream& operator<<(std::ostream& strm, const Benchmark::Latencies& l);
@@ -0,0 +1,113 @@
+#include <thread>
+#include <atomic>
+#include <unordered_set>
+#include "Corpus.hpp"
+
+CorpusGenerator::CorpusGenerator(size_t count, uint64_t seed, unsigned int n_threads) : levels{ { 4, 14 }, { 15, 28 }, { 29, 41 } },
+    ratings{ 10000, 1000000 }, count{ count }, seed{ seed }, n_threads{ n_threads }, max_candidates{ 100 * count } {}
+
+// rng() % n rather than std::uniform_int_distribution, whose output differs from one standard library to the other
+bool CorpusGenerator::random_game(std::mt19937_64& rng, const Level& level, Position& P, std::string& moves) {
+    P = Position();
+    moves.clear();
+    int n_moves = level.min_moves + (int)(rng() % (level.max_moves - level.min_moves + 1));
+    while (P.nb_moves < n_moves) {
+        board possible = P.nonlosing_moves() & ~P.winning_moves(); // the game goes on
+        if (!possible) return false;
+        int k = (int)(rng() % Position::popcount(possible));
+        for (int col = 0; col < Position::WIDTH; col++) {
+            board move = possible & Position::COL_MASK(col);
+            if (move && k-- == 0) {
+                P.play_move(move);
+                moves += char('1' + col);
+                break;
+            }
+        }
+    }
+    return !P.winning_moves() && P.nonlosing_moves();
+}
+
+void CorpusGenerator::solve(std::vector<Candidate>& batch, std::vector<std::unique_ptr<Solver>>& solvers) {
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&](Solver& S) {
+        for (size_t i = next++; i < batch.size(); i = next++) {
+            Candidate& c = batch[i];
+            Position P(c.moves);
+            S.T->clear();
+            unsigned long long nodes_before = S.nodeCount;
+            c.score = S.solve(P);
+            c.nodes = S.nodeCount - nodes_before;
+
+            S.T->clear(); // the score again, from other windows than the last ones of solve, in the generation of solve
+            c.verified = S.negamax(P, c.score - 1, c.score) >= c.score && S.negamax(P, c.score, c.score + 1) <= c.score;
+        }
+    };
+    std::vector<std::thread> workers;
+    for (auto& S : solvers) workers.emplace_back(worker, std::ref(*S));
+    for (auto& t : workers) t.join();
+}
+
+bool CorpusGenerator::generate(const std::string& prefix, std::ostream& strm) {
+    std::vector<std::unique_ptr<Solver>> solvers;
+    for (unsigned int i = 0; i < std::max(1u, n_threads); i++) {
+        solvers.push_back(std::make_unique<Solver>());
+        solvers.back()->book = nullptr; // the cost of the search itself, from a cold table
+        solvers.back()->set_endgame(nullptr);
+    }
+
+    auto clock = std::chrono::steady_clock();
+    for (size_t l = 0; l < levels.size(); l++) {
+        auto t1 = clock.now();
+        std::seed_seq seq{ (uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)l };
+        std::mt19937_64 rng(seq);
+        std::vector<std::vector<Candidate>> files(ratings.size() + 1);
+        std::unordered_set<board> seen; // canonical keys of the positions drawn so far
+        size_t n_drawn = 0, n_solved = 0, n_unverified = 0;
+        auto full = [&]() { return std::all_of(files.begin(), files.end(), [&](auto& f) { return f.size() >= count; }); };
+
+        while (!full() && n_drawn < max_candidates) {
+            std::vector<Candidate> batch;
+            while (batch.size() < BATCH && n_drawn < max_candidates) {
+                n_drawn++;
+                Position P;
+                Candidate c{};
+                if (random_game(rng, levels[l], P, c.moves) && seen.insert(P.canonical_key()).second) batch.push_back(c);
+            }
+            solve(batch, solvers);
+            n_solved += batch.size();
+            bool added = false;
+            for (Candidate& c : batch) {
+                if (!c.verified) {
+                    n_unverified++;
+                    continue;
+                }
+                size_t r = std::upper_bound(ratings.begin(), ratings.end(), c.nodes) - ratings.begin();
+                if (files[r].size() < count) {
+                    files[r].push_back(std::move(c));
+                    added = true;
+                }
+            }
+            if (added) {
+                strm << "  " << n_solved << " solved, positions per rating:";
+                for (auto& f : files) strm << " " << f.size();
+                strm << std::endl;
+            }
+        }
+
+        strm << "Level " << l + 1 << " (" << levels[l].min_moves << "-" << levels[l].max_moves << " moves): " << n_drawn << " games, "
+             << n_solved << " positions solved in " << std::chrono::duration<double>(clock.now() - t1).count() << "s"
+             << (n_unverified ? ", UNVERIFIED SCORES: " + std::to_string(n_unverified) : "") << "\n";
+        for (size_t r = 0; r < files.size(); r++) {
+            std::string filename = prefix + "_L" + std::to_string(l + 1) + "_R" + std::to_string(r + 1);
+            std::ofstream out(filename);
+            if (!out.is_open()) {
+                std::cout << "Failed to open file: " << filename << "\n";
+                return false;
+            }
+            for (const Candidate& c : files[r]) out << c.moves << " " << c.score << "\n";
+            strm << "  " << filename << ": " << files[r].size() << " positions"
+                 << (files[r].size() < count ? " (not full)" : "") << "\n";
+        }
+    }
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include "Solver.hpp"
+
+/**
+* Generator of test files in the format of Tests/: one "moves score" line per position, moves indexed from '1'.
+* Files are named <prefix>_L<level>_R<rating>, like the ones of Tests/: levels are ranges of the number of moves
+* played, ratings ranges of the cost of the solve.
+*
+* Positions come from random games: every move is drawn among the moves that neither lose at once nor end the game,
+* up to a number of moves drawn in the range of the level. Positions where the player to move can win at once, or
+* has no nonlosing move, are discarded, as are positions already drawn (up to symmetry).
+*
+* The candidates are solved on a pool of threads, each of them on a table cleared before every position and without
+* book or endgame table, so that the nodes of a position do not depend on the ones solved before it. The score is then
+* checked with two null-window searches on a cleared table again, and the position goes to the rating of its nodes.
+*
+* Everything derives from the seed: each level draws its games from its own generator, seeded with the seed and the
+* level, and the candidates are assigned in the order they were drawn, in batches. The same seed, table size and
+* build give the same files, whatever the number of threads.
+*/
+class CorpusGenerator {
+public:
+	struct Level {
+		int min_moves, max_moves;
+	};
+
+	std::vector<Level> levels;               // default: the ranges of Tests/, 4-14, 15-28 and 29-41 moves
+	std::vector<unsigned long long> ratings; // upper bounds of the nodes of each rating but the last, default 10^4 and 10^6
+	size_t count;                            // lines per file
+	uint64_t seed;
+	unsigned int n_threads;
+	size_t max_candidates; // games drawn per level before giving up on the files still not full (default 100 per line)
+
+	CorpusGenerator(size_t count, uint64_t seed, unsigned int n_threads);
+
+	// Write the files of every level and rating. Returns false if a file cannot be written.
+	// Reports the progress of each level, and the files with less than 'count' lines.
+	bool generate(const std::string& prefix, std::ostream& strm);
+
+private:
+	static constexpr size_t BATCH = 64; // candidates solved between two assignments, whatever the number of threads
+
+	struct Candidate {
+		std::string moves;
+		int score;
+		unsigned long long nodes;
+		bool verified;
+	};
+
+	// Play a random game of the level. Returns false if it has to be discarded.
+	static bool random_game(std::mt19937_64& rng, const Level& level, Position& P, std::string& moves);
+
+	// Solve and check the candidates, one thread per solver
+	static void solve(std::vector<Candidate>& batch, std::vector<std::unique_ptr<Solver>>& solvers);
+};
@@ -0,0 +1,160 @@
+#include "Dfpn.hpp"
+
+template<int WIDTH, int HEIGHT>
+BasicDfpnSolver<WIDTH, HEIGHT>::BasicDfpnSolver(size_t bytes) : nodeCount{ 0 }, node_limit{ ULLONG_MAX }, attacker{ 0 }, generation{ 0 }, aborted{ false } {
+    n_buckets = std::max<size_t>(bytes / (sizeof(Entry) * BUCKET_SIZE), 1);
+    table.resize(n_buckets * BUCKET_SIZE);
+}
+
+template<int WIDTH, int HEIGHT>
+typename BasicDfpnSolver<WIDTH, HEIGHT>::Result BasicDfpnSolver<WIDTH, HEIGHT>::prove(const Position& P, int attacker_parity) {
+    attacker = attacker_parity;
+    aborted = false;
+    generation++;
+    uint32_t pn, dn;
+    if (!evaluate(P, pn, dn)) {
+        board key = P.canonical_key();
+        mid(P, key, INF, INF);
+        lookup(P, key, pn, dn);
+    }
+    if (pn == 0) return Result::Proven;
+    if (dn == 0) return Result::Disproven;
+    return Result::Unknown;
+}
+
+// Proof and disproof numbers of a position never searched. Returns true if the game is decided: the player to move
+// wins with their next move, loses whatever they play, or the game is a draw (see negamax). Otherwise the player to
+// move needs one of their nonlosing moves to succeed, and the other player all of them.
+template<int WIDTH, int HEIGHT>
+bool BasicDfpnSolver<WIDTH, HEIGHT>::evaluate(const Position& P, uint32_t& pn, uint32_t& dn) const {
+    bool attacker_to_move = (P.nb_moves & 1) == attacker;
+    if (P.winning_moves()) {
+        pn = attacker_to_move ? 0 : INF;
+        dn = attacker_to_move ? INF : 0;
+        return true;
+    }
+    board moves = P.nonlosing_moves();
+    if (!moves) {
+        pn = attacker_to_move ? INF : 0;
+        dn = attacker_to_move ? 0 : INF;
+        return true;
+    }
+    if (P.nb_moves >= Position::BOARD_SIZE - 2) { // draw
+        pn = INF;
+        dn = 0;
+        return true;
+    }
+    uint32_t n = Position::popcount(moves);
+    pn = attacker_to_move ? 1 : n;
+    dn = attacker_to_move ? n : 1;
+    return false;
+}
+
+// Index of the first entry of the bucket of a key. The keys are mixed first: their raw bits fall in a few residues of
+// some table sizes, and siblings evicting each other's numbers make mid loop forever.
+template<int WIDTH, int HEIGHT>
+size_t BasicDfpnSolver<WIDTH, HEIGHT>::bucket_index(board key) const {
+    uint64_t h;
+    if constexpr (sizeof(board) > sizeof(uint64_t)) h = ((uint64_t)key ^ (uint64_t)(key >> 64) * 0xC2B2AE3D27D4EB4FULL) * 0x9E3779B97F4A7C15ULL;
+    else h = key * 0x9E3779B97F4A7C15ULL;
+    return (h >> 16) % n_buckets * BUCKET_SIZE;
+}
+
+// Proof and disproof numbers of P (of canonical key 'key'): from the table, or from evaluate
+template<int WIDTH, int HEIGHT>
+void BasicDfpnSolver<WIDTH, HEIGHT>::lookup(const Position& P, board key, uint32_t& pn, uint32_t& dn) const {
+    const Entry* bucket = &table[bucket_index(key)];
+    for (int i = 0; i < BUCKET_SIZE; i++)
+        if (bucket[i].key == key && bucket[i].attacker == attacker && (bucket[i].pn || bucket[i].dn)) {
+            pn = bucket[i].pn;
+            dn = bucket[i].dn;
+            return;
+        }
+    evaluate(P, pn, dn);
+}
+
+template<int WIDTH, int HEIGHT>
+void BasicDfpnSolver<WIDTH, HEIGHT>::store(board key, uint32_t pn, uint32_t dn, unsigned long long work) {
+    Entry* bucket = &table[bucket_index(key)];
+    Entry* e = bucket;
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        if (bucket[i].key == key && bucket[i].attacker == attacker) {
+            e = &bucket[i];
+            break;
+        }
+        // Entries of earlier searches go first, then the ones with the least work (empty entries have none). Evicting
+        // the numbers of the positions on the current path would make mid search them again, possibly forever.
+        if (std::make_pair(bucket[i].generation == generation, bucket[i].work) < std::make_pair(e->generation == generation, e->work))
+            e = &bucket[i];
+    }
+    *e = Entry{ key, pn, dn, (uint32_t)std::min<unsigned long long>(work, UINT32_MAX), (uint16_t)attacker, generation };
+}
+
+// Multiple iterative deepening (Nagai): search P until its proof number reaches thpn or its disproof number reaches
+// thdn, always going down to the child that is the closest to proving (or disproving) P
+template<int WIDTH, int HEIGHT>
+void BasicDfpnSolver<WIDTH, HEIGHT>::mid(const Position& P, board key, uint32_t thpn, uint32_t thdn) {
+    unsigned long long nodes_before = nodeCount++;
+    if (nodeCount > node_limit || stop.stop_requested()) aborted = true;
+    if (aborted) return;
+
+    bool attacker_to_move = (P.nb_moves & 1) == attacker;
+    Position children[WIDTH];
+    board keys[WIDTH]; // canonical keys of the children, looked up at each iteration
+    int n_children = 0;
+    board possible = P.nonlosing_moves(); // P is not a leaf: there are nonlosing moves and no winning move
+    for (int i = 0; i < WIDTH; i++) {
+        int col = WIDTH / 2 + (1 - 2 * (i % 2)) * (i + 1) / 2; // center columns first
+        if (board move = possible & Position::COL_MASK(col)) {
+            children[n_children] = P;
+            children[n_children].play_move(move);
+            keys[n_children] = children[n_children].canonical_key();
+            n_children++;
+        }
+    }
+
+    // The attacker needs one child proven where they are to move, and all of them where the defender is. With phi the
+    // proof number at attacker nodes and the disproof number at defender nodes, and delta the other one, this is the
+    // same at every node: phi = min of the children's delta, delta = sum of the children's phi.
+    uint32_t phi, delta;
+    while (true) {
+        uint32_t child_phi[WIDTH], child_delta[WIDTH];
+        phi = INF;
+        unsigned long long sum = 0;
+        bool disproven = false; // a child whose phi is infinite
+        int best = 0;
+        uint32_t second = INF; // second smallest child delta
+        for (int i = 0; i < n_children; i++) {
+            uint32_t pn, dn;
+            lookup(children[i], keys[i], pn, dn);
+            child_phi[i] = attacker_to_move ? dn : pn; // the defender is to move at the children of an attacker node
+            child_delta[i] = attacker_to_move ? pn : dn;
+            sum += child_phi[i];
+            disproven |= child_phi[i] == INF;
+            if (child_delta[i] < phi) {
+                second = phi;
+                phi = child_delta[i];
+                best = i;
+            }
+            else if (child_delta[i] < second) second = child_delta[i];
+        }
+        delta = disproven ? INF : (uint32_t)std::min<unsigned long long>(sum, INF - 1);
+
+        uint32_t th_phi = attacker_to_move ? thpn : thdn;
+        uint32_t th_delta = attacker_to_move ? thdn : thpn;
+        if (phi >= th_phi || delta >= th_delta || aborted) break;
+
+        // 1 + epsilon trick (Pawlewicz and Lew): stay a little longer in the best child before switching to the second
+        uint32_t child_th_delta = std::min<unsigned long long>(th_phi, second == INF ? INF : second + second / 4 + 1);
+        uint32_t child_th_phi = (uint32_t)std::min<unsigned long long>((unsigned long long)th_delta - delta + child_phi[best], INF);
+        if (attacker_to_move) mid(children[best], keys[best], child_th_delta, child_th_phi); // pn of the child is its delta
+        else mid(children[best], keys[best], child_th_phi, child_th_delta);
+    }
+    if (!aborted) store(key, attacker_to_move ? phi : delta, attacker_to_move ? delta : phi, nodeCount - nodes_before);
+}
+
+template class BasicDfpnSolver<7, 6>;
+template class BasicDfpnSolver<8, 7>;
+#if defined(__SIZEOF_INT128__)
+template class BasicDfpnSolver<9, 7>;
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <vector>
+#include <climits>
+#include <stop_token>
+#include "Position.hpp"
+
+/**
+* Depth-first proof-number search (df-pn): proves or disproves that one player, the attacker, can force a win.
+* Unlike alpha_beta it does not look for the distance to the end of the game, only for the outcome, and it expands
+* the positions that are closest to a proof (or a disproof) first.
+*
+* Every position has a proof number (how many positions must still be proven for the attacker to win) and a disproof
+* number, stored in a fixed-size table of its own. Moves are generated with Position's bitboards: a position with a
+* winning move or without nonlosing move is a leaf, and only the nonlosing moves of the others are searched. Their
+* number gives the initial proof or disproof number of a position.
+* A draw is a disproof.
+*/
+template<int WIDTH, int HEIGHT>
+class BasicDfpnSolver {
+public:
+	typedef BasicPosition<WIDTH, HEIGHT> Position;
+	typedef typename Position::board board;
+
+	enum class Result { Proven, Disproven, Unknown };
+
+	static constexpr uint32_t INF = 1u << 30;
+
+	// Size used by the default constructor. Can be changed at startup (see main).
+	static inline size_t default_bytes = 64 << 20;
+
+	unsigned long long nodeCount;  // positions expanded
+	unsigned long long node_limit; // the search gives up with Unknown once nodeCount exceeds it (ULLONG_MAX for no limit)
+	std::stop_token stop;          // when stop is requested, the search gives up with Unknown
+
+	BasicDfpnSolver(size_t bytes = default_bytes);
+
+	// Can the player to move force a win? Disproven if the game is a draw or a loss for them.
+	Result prove_win(const Position& P) { return prove(P, P.nb_moves & 1); }
+
+	// Can the opponent of the player to move force a win?
+	Result prove_loss(const Position& P) { return prove(P, !(P.nb_moves & 1)); }
+
+private:
+	struct Entry {
+		board key;        // key of the position, 0 if the entry is empty
+		uint32_t pn, dn;
+		uint32_t work;    // nodes spent on the position, the entry with the least work is replaced first
+		uint16_t attacker; // parity of the number of moves of the positions where the attacker is to move
+		uint16_t generation; // search that stored the entry
+	};
+	static constexpr int BUCKET_SIZE = 8;
+
+	std::vector<Entry> table; // buckets of BUCKET_SIZE entries
+	size_t n_buckets;
+	uint16_t attacker; // parity of nb_moves when the attacker is to move
+	uint16_t generation; // incremented by each call to prove
+	bool aborted;
+
+	Result prove(const Position& P, int attacker);
+	void mid(const Position& P, board key, uint32_t thpn, uint32_t thdn);
+	size_t bucket_index(board key) const;
+	void lookup(const Position& P, board key, uint32_t& pn, uint32_t& dn) const;
+	bool evaluate(const Position& P, uint32_t& pn, uint32_t& dn) const;
+	void store(board key, uint32_t pn, uint32_t dn, unsigned long long work);
+};
+
+typedef BasicDfpnSolver<Position::WIDTH, Position::HEIGHT> DfpnSolver;
@@ -0,0 +1,149 @@
+#include <unordered_map>
+#include "EndgameTable.hpp"
+#include "Solver.hpp"
+
+bool EndgameTable::load(const std::string& filename) {
+    header = nullptr;
+    if (!file.open(filename)) {
+        std::cout << "Failed to open endgame table: " << filename << "\n";
+        return false;
+    }
+
+    const Header* h = reinterpret_cast<const Header*>(file.data);
+    size_t directory_bytes = file.size >= sizeof(Header) ? (((size_t)1 << h->index_bits) + 1) * sizeof(uint32_t) : 0;
+    directory_bytes = (directory_bytes + 7) / 8 * 8; // entries stay 8-byte aligned
+    if (file.size < sizeof(Header) || memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != VERSION
+        || h->width != Position::WIDTH || h->height != Position::HEIGHT || h->index_bits > 32
+        || file.size != sizeof(Header) + directory_bytes + h->n_entries * sizeof(uint64_t)) {
+        std::cout << "Invalid endgame table: " << filename << "\n";
+        file.close();
+        return false;
+    }
+
+    header = h;
+    directory = reinterpret_cast<const uint32_t*>(file.data + sizeof(Header));
+    entries = reinterpret_cast<const uint64_t*>(file.data + sizeof(Header) + directory_bytes);
+    return true;
+}
+
+// Score of a position where the current player can win with the next move
+static int winning_score(const Position& P) {
+    return (Position::BOARD_SIZE + 1 - P.nb_moves) / 2;
+}
+
+bool EndgameTable::generate(const std::string& filename, int empty, const std::vector<std::string>& test_files, size_t max_lines, std::ostream& strm) {
+    if (empty < 1 || empty >= Position::BOARD_SIZE) return false;
+    const int first = Position::BOARD_SIZE - empty; // moves played in the positions of the first level
+
+    // Positions with 'first' moves reached by the searches, or later roots, by canonical key
+    std::unordered_map<board, Position> frontier;
+    auto clock = std::chrono::steady_clock();
+    auto t1 = clock.now();
+    {
+        Solver S;
+        S.set_endgame(nullptr);
+        S.endgame_moves = first;
+        S.on_endgame_miss = [&](const Position& P) {
+            if (P.nb_moves == first) frontier.emplace(P.canonical_key(), P);
+        };
+        for (const std::string& f : test_files) {
+            std::vector<std::string> positions;
+            std::vector<int> expected;
+            if (!Solver::read_test_file(f, positions, expected)) return false;
+            if (max_lines && positions.size() > max_lines) positions.resize(max_lines);
+            for (const std::string& moves : positions) {
+                Position P(moves);
+                if (P.nb_moves >= first) frontier.emplace(P.canonical_key(), P);
+                else S.solve(P);
+            }
+        }
+    }
+    strm << "Collected " << frontier.size() << " positions with " << empty << " empty cells in "
+         << std::chrono::duration<double>(clock.now() - t1).count() << "s" << std::endl;
+
+    // levels[d] holds the positions with d moves reachable from the frontier, sorted by canonical key
+    std::vector<std::vector<Position>> levels(Position::BOARD_SIZE + 1);
+    auto by_key = [](const Position& a, const Position& b) { return a.canonical_key() < b.canonical_key(); };
+    auto same_key = [](const Position& a, const Position& b) { return a.canonical_key() == b.canonical_key(); };
+    for (auto& [key, P] : frontier) levels[P.nb_moves].push_back(P);
+    frontier.clear();
+    for (int d = first; d <= Position::BOARD_SIZE; d++) {
+        std::sort(levels[d].begin(), levels[d].end(), by_key);
+        levels[d].erase(std::unique(levels[d].begin(), levels[d].end(), same_key), levels[d].end());
+        if (d == Position::BOARD_SIZE) break;
+        for (const Position& P : levels[d]) {
+            if (P.winning_moves()) continue; // scored without its children
+            for (int col = 0; col < Position::WIDTH; col++) {
+                board move = P.get_legal() & Position::COL_MASK(col);
+                if (!move) continue;
+                Position child(P);
+                child.play_move(move);
+                levels[d + 1].push_back(child);
+            }
+        }
+    }
+
+    // Retrograde analysis: full boards are draws, and every other position takes the best of its children
+    std::vector<std::vector<int8_t>> scores(Position::BOARD_SIZE + 1);
+    for (int d = Position::BOARD_SIZE; d >= first; d--) {
+        scores[d].resize(levels[d].size());
+        for (size_t i = 0; i < levels[d].size(); i++) {
+            const Position& P = levels[d][i];
+            if (d == Position::BOARD_SIZE) {
+                scores[d][i] = 0;
+                continue;
+            }
+            if (P.winning_moves()) {
+                scores[d][i] = winning_score(P);
+                continue;
+            }
+            int best = -Position::BOARD_SIZE;
+            for (int col = 0; col < Position::WIDTH; col++) {
+                board move = P.get_legal() & Position::COL_MASK(col);
+                if (!move) continue;
+                Position child(P);
+                child.play_move(move);
+                auto it = std::lower_bound(levels[d + 1].begin(), levels[d + 1].end(), child, by_key);
+                best = std::max(best, -scores[d + 1][it - levels[d + 1].begin()]);
+            }
+            scores[d][i] = best;
+        }
+    }
+
+    std::vector<uint64_t> table_entries;
+    for (int d = first; d <= Position::BOARD_SIZE; d++)
+        for (size_t i = 0; i < levels[d].size(); i++)
+            table_entries.push_back(levels[d][i].canonical_key() << 8 | (uint8_t)scores[d][i]);
+    std::sort(table_entries.begin(), table_entries.end(), [](uint64_t a, uint64_t b) { return hash(a >> 8) < hash(b >> 8); });
+
+    // about 4 entries per bucket
+    int index_bits = 1;
+    while (index_bits < 32 && ((uint64_t)4 << index_bits) < table_entries.size()) index_bits++;
+    std::vector<uint32_t> dir(((size_t)1 << index_bits) + 1);
+    size_t e = 0;
+    for (size_t b = 0; b < dir.size(); b++) {
+        while (e < table_entries.size() && (hash(table_entries[e] >> 8) >> (64 - index_bits)) < b) e++;
+        dir[b] = (uint32_t)e;
+    }
+    dir.resize((dir.size() + 1) / 2 * 2, (uint32_t)table_entries.size()); // entries stay 8-byte aligned
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        std::cout << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    Header h{};
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.width = Position::WIDTH;
+    h.height = Position::HEIGHT;
+    h.empty = empty;
+    h.index_bits = index_bits;
+    h.n_entries = table_entries.size();
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(dir.data()), dir.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(table_entries.data()), table_entries.size() * sizeof(uint64_t));
+    strm << "Wrote " << table_entries.size() << " positions to " << filename << " in "
+         << std::chrono::duration<double>(clock.now() - t1).count() << "s\n";
+    return out.good();
+}
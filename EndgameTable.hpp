@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Position.hpp"
+#include "MappedFile.hpp"
+
+/**
+* Endgame table: the exact score of positions with at most 'empty' empty cells, probed by negamax instead of searching
+* the end of the game again at every visit.
+*
+* Enumerating every position of the last plies of the game is out of reach (billions of positions), so the table holds
+* the positions reachable from a workload: generate() solves the lines of test files with a Solver that records the
+* positions its search reaches with 'empty' empty cells, then enumerates everything reachable from them and scores it
+* by retrograde analysis, from the full boards back up.
+*
+* File format (native byte order):
+*   Header (32 bytes)
+*   (2^index_bits + 1) x uint32_t: directory, index of the first entry of each bucket
+*   n_entries x uint64_t: (canonical_key << 8) | (uint8_t)score, sorted by hash(canonical_key)
+*
+* The bucket of a key is given by the top index_bits bits of its hash, a bijective mix of the key, so buckets hold
+* a few entries each and a probe reads one directory slot and one or two cache lines of entries.
+* The file is memory mapped and searched in place. Standard 7x6 board only.
+*/
+class EndgameTable {
+public:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint8_t width;
+		uint8_t height;
+		uint8_t empty;      // positions with at most 'empty' empty cells may be in the table
+		uint8_t index_bits; // the directory has 2^index_bits buckets
+		uint64_t n_entries;
+		uint64_t unused;
+	};
+
+	static constexpr char MAGIC[8] = { 'C', '4', 'E', 'N', 'D', 'G', 0, 0 };
+	static constexpr uint32_t VERSION = 1;
+
+	static uint64_t hash(board key) { return key * 0x9E3779B97F4A7C15ULL; } // odd multiplier: a bijection
+
+	bool load(const std::string& filename);
+
+	// Score of P if it is in the table
+	bool get(const Position& P, int& score) const {
+		if (!header) return false;
+		board key = P.canonical_key();
+		uint64_t bucket = hash(key) >> (64 - header->index_bits);
+		for (uint32_t i = directory[bucket]; i < directory[bucket + 1]; i++)
+			if ((entries[i] >> 8) == key) {
+				score = (int8_t)(entries[i] & 0xFF);
+				return true;
+			}
+		return false;
+	}
+
+	// Number of moves played from which positions may be in the table, BOARD_SIZE + 1 without a table
+	int min_moves() const { return header ? Position::BOARD_SIZE - header->empty : Position::BOARD_SIZE + 1; }
+	uint64_t size() const { return header ? header->n_entries : 0; }
+
+	// Solve the first max_lines lines (0 for all) of the test files, collecting the positions with 'empty' empty
+	// cells reached by the searches, then score every position reachable from them and write the table to 'filename'
+	static bool generate(const std::string& filename, int empty, const std::vector<std::string>& test_files, size_t max_lines, std::ostream& strm);
+
+private:
+	MappedFile file;
+	const Header* header = nullptr;
+	const uint32_t* directory = nullptr;
+	const uint64_t* entries = nullptr;
+};
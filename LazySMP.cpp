@@ -0,0 +1,81 @@
+#include "LazySMP.hpp"
+
+LazySMPSolver::LazySMPSolver(unsigned int n_threads) : T{ std::make_shared<TranspositionTable>() } {
+    solvers.reserve(std::max(1u, n_threads));
+    for (unsigned int i = 0; i < std::max(1u, n_threads); i++) {
+        solvers.emplace_back(T);
+        // helpers rotate the center-first order so that they start on different columns
+        // example for WIDTH=7 and i=1: columnOrder = {4, 2, 5, 1, 6, 0, 3}
+        Solver& S = solvers.back();
+        std::rotate(S.columnOrder, S.columnOrder + i % Position::WIDTH, S.columnOrder + Position::WIDTH);
+    }
+}
+
+int32_t LazySMPSolver::alpha_beta(Position& P) {
+    std::stop_source stop_source;
+    std::atomic<int32_t> result{ 0 };
+    std::atomic<bool> found{ false };
+
+    auto search = [&](Solver& S) {
+        S.stop = stop_source.get_token();
+        Position p(P);
+        int32_t score = S.alpha_beta_shared(p);
+        if (!S.stop.stop_requested() && !found.exchange(true)) {
+            result = score;
+            stop_source.request_stop();
+        }
+    };
+
+    T->new_search(); // one generation for all the threads, so that they do not evict each other's entries first
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < solvers.size(); i++)
+        helpers.emplace_back(search, std::ref(solvers[i]));
+    search(solvers[0]);
+    for (auto& t : helpers) t.join();
+
+    for (Solver& S : solvers) S.stop = std::stop_token();
+    return result;
+}
+
+unsigned long long LazySMPSolver::nodeCount() const {
+    unsigned long long n = 0;
+    for (const Solver& S : solvers) n += S.nodeCount;
+    return n;
+}
+
+void LazySMPSolver::benchmark(std::string filename, unsigned int max_threads, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return;
+
+    auto clock = std::chrono::steady_clock();
+    std::vector<int> reference(positions.size());
+    double reference_seconds;
+    {
+        Solver S;
+        auto t1 = clock.now();
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position p(positions[i]);
+            reference[i] = S.alpha_beta(p);
+        }
+        reference_seconds = std::chrono::duration<double>(clock.now() - t1).count();
+        strm << "alpha_beta: " << reference_seconds << "s, " << S.nodeCount << " nodes\n";
+    }
+
+    for (unsigned int n = 1; n <= max_threads; n *= 2) {
+        LazySMPSolver L(n);
+        int n_different = 0;
+        auto t1 = clock.now();
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position p(positions[i]);
+            if (L.alpha_beta(p) != reference[i]) n_different++;
+        }
+        double seconds = std::chrono::duration<double>(clock.now() - t1).count();
+        strm << n << " threads: " << seconds << "s, " << L.nodeCount() << " nodes, speedup " << reference_seconds / seconds
+             << (n_different ? ", DIFFERENT SCORES: " + std::to_string(n_different) : ", identical scores") << "\n";
+    }
+
+    int n_mismatches = 0;
+    for (size_t i = 0; i < positions.size(); i++) n_mismatches += reference[i] != expected[i];
+    if (n_mismatches) strm << "Mismatched scores: " << n_mismatches << "\n";
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include "Solver.hpp"
+
+/**
+* Lazy SMP: several threads solve the same root position, sharing one lock-free TranspositionTable.
+*
+* Each thread runs the full alpha_beta loop with its own column exploration order, so the threads
+* spread over different parts of the tree and feed each other bounds through the shared table.
+* Every thread computes the exact score on its own, so the first one to finish gives the answer
+* and the others are stopped.
+*/
+class LazySMPSolver {
+public:
+	std::shared_ptr<TranspositionTable> T;
+	std::vector<Solver> solvers; // solvers[0] uses the default center-first column order
+
+	LazySMPSolver(unsigned int n_threads);
+
+	int32_t alpha_beta(Position& P);
+
+	unsigned long long nodeCount() const;
+
+	// Solve every line of a test file with the single-threaded Solver, then with 1, 2, 4, ... max_threads
+	// Lazy SMP threads, and report the speedup and whether the scores are identical
+	static void benchmark(std::string filename, unsigned int max_threads, std::ostream& strm);
+};
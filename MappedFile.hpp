@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+* Read-only memory mapping of a whole file.
+* The contents are paged in by the OS on first access, so opening a large file costs nothing up front.
+*/
+class MappedFile {
+public:
+	const char* data;
+	size_t size;
+
+	MappedFile() : data{ nullptr }, size{ 0 } {}
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile() { close(); }
+
+	bool open(const std::string& filename) {
+		close();
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) { CloseHandle(file); return false; }
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping) return false;
+		void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping); // the view keeps the mapping alive
+		if (!p) return false;
+		size = (size_t)file_size.QuadPart;
+#else
+		int fd = ::open(filename.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+		void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd); // the mapping stays valid after the descriptor is closed
+		if (p == MAP_FAILED) return false;
+		size = (size_t)st.st_size;
+#endif
+		data = static_cast<const char*>(p);
+		return true;
+	}
+
+	void close() {
+		if (!data) return;
+#if defined(_WIN32)
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<char*>(data), size);
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	bool is_open() const { return data != nullptr; }
+};
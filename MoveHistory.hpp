@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstring>
+#include "Position.hpp"
+
+/**
+* Move ordering learned from the search: which moves caused beta cutoffs.
+*
+* - killers: for each number of moves played, the last move that caused a cutoff at that depth
+* - history: for each cell, the sum of the squared depths (empty cells left) of the cutoffs its move caused
+*
+* score() blends them into the MoveScorer score of a move: the number of threats still comes first, then the killer,
+* then the history. Ties left after that keep the column order of the Solver.
+* The tables belong to one Solver. They are cleared at every root search unless 'persist' is set, in which case
+* what was learned on one position of a batch carries over to the next.
+*
+* Both are off by default: on the Tests/ files they cost more nodes than they save (see C4Bench --move-history).
+* The history overrides the center-first column order among moves with as many threats, which is the better order
+* for Connect 4, and the killers help on some levels and hurt on others.
+*/
+template<int WIDTH, int HEIGHT>
+class BasicMoveHistory {
+public:
+	typedef BasicPosition<WIDTH, HEIGHT> Position;
+	typedef typename Position::board board;
+
+	static constexpr int CELLS = WIDTH * (HEIGHT + 1);
+	static constexpr int HISTORY_BITS = 16;           // history values stay below 2^16
+	static constexpr int KILLER_BONUS = 1 << HISTORY_BITS;
+	static constexpr int THREAT_SCALE = 2 << HISTORY_BITS;
+
+	bool use_killers;
+	bool use_history;
+	bool persist;
+
+	BasicMoveHistory() : use_killers{ false }, use_history{ false }, persist{ false } { clear(); }
+
+	bool enabled() const { return use_killers || use_history; }
+
+	void clear() {
+		memset(killers, 0, sizeof(killers));
+		memset(history, 0, sizeof(history));
+	}
+
+	// Score given to MoveSorter for a move with 'threats' threats, in a position with 'nb_moves' moves played
+	int score(int threats, int nb_moves, board move) const {
+		return threats * THREAT_SCALE + (use_killers && killers[nb_moves] == move ? KILLER_BONUS : 0)
+			+ (use_history ? history[Position::bit_index(move)] : 0);
+	}
+
+	void cutoff(int nb_moves, board move) {
+		killers[nb_moves] = move;
+		int empty = Position::BOARD_SIZE - nb_moves;
+		int& h = history[Position::bit_index(move)];
+		h += empty * empty;
+		if (h >= KILLER_BONUS) // age the whole table, keeping the order of the moves
+			for (int& x : history) x >>= 1;
+	}
+
+private:
+	board killers[Position::BOARD_SIZE + 1];
+	int history[CELLS];
+};
+
+typedef BasicMoveHistory<Position::WIDTH, Position::HEIGHT> MoveHistory;
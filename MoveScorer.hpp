@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstring>
+#include "Position.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#define C4_SIMD_SCORING 1
+#include <immintrin.h>
+#define C4_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#define C4_TARGET_AVX512 __attribute__((target("avx512f,avx512vpopcntdq")))
+#else
+#define C4_SIMD_SCORING 0
+#endif
+
+/**
+* Scores all the candidate moves of a node in one pass.
+*
+* For each candidate move m of P, computes the cells the current player threatens after playing m (among the
+* cells that are empty in P), and the score of m: the number of these cells, the same as P.moveScore(m).
+* The children are independent, so the shift cascade of get_threats runs with one SIMD lane per child:
+* 8 children per AVX-512 vector, 4 per AVX2 vector.
+*
+* The kernel is chosen at startup from the features of the CPU, and can be changed (see C4Bench --move-scoring).
+* Other compilers and architectures, and boards of more than 64 bits, use the scalar loop.
+*/
+template<int WIDTH, int HEIGHT>
+class BasicMoveScorer {
+public:
+	typedef BasicPosition<WIDTH, HEIGHT> Position;
+	typedef typename Position::board board;
+
+	// Size of the moves, threats and scores arrays: whole vectors of 8 lanes
+	static constexpr int LANES = (WIDTH + 7) / 8 * 8;
+
+	enum class Kernel { Scalar, AVX2, AVX512 };
+
+	static bool supported(Kernel k) {
+		if (k == Kernel::Scalar) return true;
+#if C4_SIMD_SCORING
+		if constexpr (sizeof(board) == sizeof(uint64_t)) {
+			__builtin_cpu_init(); // may run before the static constructors of libgcc
+			if (k == Kernel::AVX2) return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+			if (k == Kernel::AVX512) return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq");
+		}
+#endif
+		return false;
+	}
+
+	static Kernel best_kernel() {
+		if (supported(Kernel::AVX512)) return Kernel::AVX512;
+		if (supported(Kernel::AVX2)) return Kernel::AVX2;
+		return Kernel::Scalar;
+	}
+
+	static const char* name(Kernel k) {
+		return k == Kernel::AVX512 ? "avx512" : k == Kernel::AVX2 ? "avx2" : "scalar";
+	}
+
+	static inline Kernel kernel = best_kernel();
+
+	// Score the n first entries of 'moves'. moves, threats and scores must have LANES entries, the moves after the n-th being 0.
+	static void score(const Position& P, const board* moves, int n, board* threats, int* scores) {
+#if C4_SIMD_SCORING
+		if constexpr (sizeof(board) == sizeof(uint64_t)) {
+			if (kernel == Kernel::AVX512) return score_avx512(P, moves, n, threats, scores);
+			if (kernel == Kernel::AVX2) return score_avx2(P, moves, n, threats, scores);
+		}
+#endif
+		score_scalar(P, moves, n, threats, scores);
+	}
+
+	static void score_scalar(const Position& P, const board* moves, int n, board* threats, int* scores) {
+		board empty = Position::BOARD_MASK ^ P.all_mask;
+		for (int i = 0; i < n; i++) {
+			Position::threats(P.current_mask | moves[i], threats[i]);
+			threats[i] &= empty;
+			scores[i] = Position::popcount(threats[i]);
+		}
+	}
+
+#if C4_SIMD_SCORING
+	C4_TARGET_AVX2 static void score_avx2(const Position& P, const board* moves, int n, board* threats, int* scores) {
+		typedef uint64_t v4 __attribute__((vector_size(32)));
+		board empty = Position::BOARD_MASK ^ P.all_mask;
+		for (int i = 0; i < n; i += 4) {
+			v4 m, t;
+			memcpy(&m, moves + i, sizeof(m));
+			m |= P.current_mask;
+			Position::threats(m, t);
+			t &= empty;
+			memcpy(threats + i, &t, sizeof(t));
+		}
+		for (int i = 0; i < n; i++) scores[i] = (int)_mm_popcnt_u64(threats[i]); // AVX2 has no 64-bit popcount
+	}
+
+	C4_TARGET_AVX512 static void score_avx512(const Position& P, const board* moves, int n, board* threats, int* scores) {
+		typedef uint64_t v8 __attribute__((vector_size(64)));
+		board empty = Position::BOARD_MASK ^ P.all_mask;
+		for (int i = 0; i < n; i += 8) {
+			v8 m, t;
+			memcpy(&m, moves + i, sizeof(m));
+			m |= P.current_mask;
+			Position::threats(m, t);
+			t &= empty;
+			memcpy(threats + i, &t, sizeof(t));
+			// zero-masked narrowing: the unmasked form merges into an undefined register, which GCC warns about
+			__m256i counts = _mm512_maskz_cvtepi64_epi32(0xFF, _mm512_popcnt_epi64((__m512i)t));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(scores + i), counts);
+		}
+	}
+#endif
+};
+
+typedef BasicMoveScorer<Position::WIDTH, Position::HEIGHT> MoveScorer;
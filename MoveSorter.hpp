@@ -13,14 +13,18 @@
 * and also efficient if the move are pushed in approximatively increasing
 * order which can be acheived by using a simpler column ordering heuristic.
 */
-class MoveSorter {
+template<int WIDTH, int HEIGHT>
+class BasicMoveSorter {
+public:
+    typedef typename BasicPosition<WIDTH, HEIGHT>::board board;
+
 private:
     unsigned int size; // number of stored moves
 
     struct {
         board move;
         int score;
-    } entries[Position::WIDTH];
+    } entries[WIDTH];
 
 
 public:
@@ -39,5 +43,7 @@ public:
             return 0;
     }
 
-    MoveSorter() : size{ 0 } { }
-};
\ No newline at end of file
+    BasicMoveSorter() : size{ 0 } { }
+};
+
+typedef BasicMoveSorter<Position::WIDTH, Position::HEIGHT> MoveSorter;
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "OpeningBook.hpp"
+#include "Solver.hpp"
+
+bool OpeningBook::load(const std::string& filename) {
+    header = nullptr;
+    entries = nullptr;
+    if (!file.open(filename)) {
+        std::cout << "Failed to open book: " << filename << "\n";
+        return false;
+    }
+
+    const Header* h = reinterpret_cast<const Header*>(file.data);
+    if (file.size < sizeof(Header) || memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != VERSION
+        || h->width != Position::WIDTH || h->height != Position::HEIGHT
+        || file.size != sizeof(Header) + h->n_entries * sizeof(uint64_t)) {
+        std::cout << "Invalid book: " << filename << "\n";
+        file.close();
+        return false;
+    }
+
+    header = h;
+    entries = reinterpret_cast<const uint64_t*>(file.data + sizeof(Header));
+    return true;
+}
+
+bool OpeningBook::get(const Position& P, int& score) const {
+    if (!header || P.nb_moves > header->depth) return false;
+
+    board key = P.canonical_key();
+    const uint64_t* end = entries + header->n_entries;
+    const uint64_t* it = std::lower_bound(entries, end, key << 8);
+    if (it == end || (*it >> 8) != key) return false;
+
+    score = (int8_t)(*it & 0xFF);
+    return true;
+}
+
+// Score of a position where the current player can win with the next move
+static int winning_score(const Position& P) {
+    return (Position::BOARD_SIZE + 1 - P.nb_moves) / 2;
+}
+
+bool OpeningBook::generate(const std::string& filename, int depth, unsigned int n_threads, std::ostream& strm, const std::string& root) {
+    // levels[d] holds the positions with d moves, sorted by canonical key
+    std::vector<std::vector<Position>> levels(depth + 1);
+    Position root_position(root);
+    if (root_position.nb_moves > depth) return false;
+    auto by_key = [](const Position& a, const Position& b) { return a.canonical_key() < b.canonical_key(); };
+    auto same_key = [](const Position& a, const Position& b) { return a.canonical_key() == b.canonical_key(); };
+
+    levels[root_position.nb_moves].push_back(root_position);
+    for (int d = root_position.nb_moves; d < depth; d++) {
+        for (const Position& P : levels[d]) {
+            board winning = P.winning_moves();
+            for (int col = 0; col < Position::WIDTH; col++) {
+                board move = P.get_legal() & Position::COL_MASK(col);
+                if (!move || (move & winning)) continue; // the game ends after a winning move
+                Position child(P);
+                child.play_move(move);
+                levels[d + 1].push_back(child);
+            }
+        }
+        std::sort(levels[d + 1].begin(), levels[d + 1].end(), by_key);
+        levels[d + 1].erase(std::unique(levels[d + 1].begin(), levels[d + 1].end(), same_key), levels[d + 1].end());
+        strm << "Positions with " << d + 1 << " moves: " << levels[d + 1].size() << std::endl;
+    }
+
+    // Search the deepest level on a pool of threads sharing one table
+    std::vector<std::vector<int8_t>> scores(depth + 1);
+    for (int d = 0; d <= depth; d++) scores[d].resize(levels[d].size());
+
+    auto clock = std::chrono::steady_clock();
+    auto t1 = clock.now();
+    auto T = std::make_shared<TranspositionTable>();
+    std::atomic<size_t> next{ 0 };
+    auto worker = [&]() {
+        Solver S(T);
+        S.book = nullptr; // the book is being built
+        for (size_t i = next++; i < levels[depth].size(); i = next++) {
+            Position P(levels[depth][i]);
+            scores[depth][i] = S.solve(P);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 0; i < std::max(1u, n_threads); i++) workers.emplace_back(worker);
+    for (auto& t : workers) t.join();
+    strm << "Solved " << levels[depth].size() << " positions in "
+         << std::chrono::duration<double>(clock.now() - t1).count() << "s\n";
+
+    // Every other position takes the best of its children, which are all in the next level
+    for (int d = depth - 1; d >= root_position.nb_moves; d--) {
+        for (size_t i = 0; i < levels[d].size(); i++) {
+            const Position& P = levels[d][i];
+            if (P.winning_moves()) {
+                scores[d][i] = winning_score(P);
+                continue;
+            }
+            int best = -Position::BOARD_SIZE;
+            for (int col = 0; col < Position::WIDTH; col++) {
+                board move = P.get_legal() & Position::COL_MASK(col);
+                if (!move) continue;
+                Position child(P);
+                child.play_move(move);
+                auto it = std::lower_bound(levels[d + 1].begin(), levels[d + 1].end(), child, by_key);
+                best = std::max(best, -scores[d + 1][it - levels[d + 1].begin()]);
+            }
+            scores[d][i] = best;
+        }
+    }
+
+    std::vector<uint64_t> book_entries;
+    for (int d = 0; d <= depth; d++)
+        for (size_t i = 0; i < levels[d].size(); i++)
+            book_entries.push_back(levels[d][i].canonical_key() << 8 | (uint8_t)scores[d][i]);
+    std::sort(book_entries.begin(), book_entries.end());
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        std::cout << "Failed to open file: " << filename << "\n";
+        return false;
+    }
+    Header h{};
+    memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.width = Position::WIDTH;
+    h.height = Position::HEIGHT;
+    h.depth = depth;
+    h.n_entries = book_entries.size();
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(reinterpret_cast<const char*>(book_entries.data()), book_entries.size() * sizeof(uint64_t));
+    strm << "Wrote " << book_entries.size() << " positions to " << filename << "\n";
+    return out.good();
+}
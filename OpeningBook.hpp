@@ -0,0 +1,51 @@
+#pragma once
+
+#include <memory>
+#include "Position.hpp"
+#include "MappedFile.hpp"
+
+/**
+* Opening book: the exact score of every position reachable within the first 'depth' moves.
+*
+* File format (native byte order):
+*   Header (32 bytes)
+*   n_entries x uint64_t: (canonical_key << 8) | (uint8_t)score, sorted in increasing order
+*
+* The file is memory mapped and searched in place (binary search), so loading a book has no parse step.
+* Positions where the last move won the game are not part of the book.
+*/
+class OpeningBook {
+public:
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint8_t width;
+		uint8_t height;
+		uint8_t depth;     // all positions with at most 'depth' moves are in the book
+		uint8_t unused;
+		uint64_t n_entries;
+		uint64_t unused2;
+	};
+
+	static constexpr char MAGIC[8] = { 'C', '4', 'B', 'O', 'O', 'K', 0, 0 };
+	static constexpr uint32_t VERSION = 1;
+
+	bool load(const std::string& filename);
+
+	// Score of P if it is in the book
+	bool get(const Position& P, int& score) const;
+
+	int depth() const { return header ? header->depth : -1; }
+	uint64_t size() const { return header ? header->n_entries : 0; }
+
+	// Enumerate and solve all positions with at most 'depth' moves, and write them to 'filename'.
+	// Only the positions with exactly 'depth' moves are searched, on n_threads threads sharing one table.
+	// Scores of earlier positions are then derived from the scores of their children.
+	// A non-empty 'root' (moves indexed from '1') restricts the book to the positions following that opening.
+	static bool generate(const std::string& filename, int depth, unsigned int n_threads, std::ostream& strm, const std::string& root = "");
+
+private:
+	MappedFile file;
+	const Header* header = nullptr;
+	const uint64_t* entries = nullptr;
+};
@@ -19,47 +19,56 @@ Ply Score is -1 for losing on the last move and decreases by 1 for losing a ply
 #pragma once
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <array>
 #include <bitset>
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
 #include "assert.h"
 
-typedef uint64_t board;
+#if defined(_MSC_VER)
+#define C4_ALWAYS_INLINE __forceinline
+#else
+#define C4_ALWAYS_INLINE inline __attribute__((always_inline))
+#endif
 
-constexpr static uint64_t bottom(int width, int height) {
-	return width == 0 ? 0 : bottom(width - 1, height) | 1LL << (width - 1) * (height + 1);
-}
+// Bitboard type of a width x height board: one bit per cell plus one extra row, in the smallest integer that holds it.
+// Boards of up to 64 bits (7x6, 8x7) use uint64_t, larger ones (9x7, 10x9, ...) a 128-bit integer.
+template<int WIDTH, int HEIGHT, bool FITS_64 = WIDTH * (HEIGHT + 1) <= 64>
+struct board_type { typedef uint64_t type; };
 
-class Position {
-private:
+#if defined(__SIZEOF_INT128__)
+template<int WIDTH, int HEIGHT>
+struct board_type<WIDTH, HEIGHT, false> { typedef unsigned __int128 type; };
+#endif
 
+template<int W, int H>
+class BasicPosition {
 public:
-	static inline int n_positions_evaluated; // Counter for total number of positions created so far
-	static inline board threat_pair_masks[10]; // The 10 masks used to check for "win_in_3"
+	typedef typename board_type<W, H>::type board;
+
+	// without unsigned __int128, board falls back to 64 bits and larger boards would silently overflow
+	static_assert(W >= 4 && H >= 4 && W * (H + 1) <= 8 * (int)sizeof(board), "unsupported board size");
 
 	board current_mask;  // mask showing slots taken by current player
 	board all_mask;		 // mask showing slots taken be either player
 	int32_t nb_moves;
-	Position() : current_mask(0), all_mask(0), nb_moves(0) {n_positions_evaluated++; }
-
-	Position(Position &p) : current_mask(p.current_mask), all_mask(p.all_mask), nb_moves(p.nb_moves) {
-		//std::cout << "Copying Position: \n";
-		n_positions_evaluated++;
-		//this->display();
-	}
+	BasicPosition() : current_mask(0), all_mask(0), nb_moves(0) {}
 	
 	// Constructor delegation
-	Position(const std::string &moves) : Position() {
+	BasicPosition(std::string_view moves) : BasicPosition() {
 		play_moves_one_ind(moves);
 	}
 
-	static constexpr int32_t HEIGHT = 6;
-	static constexpr int32_t WIDTH = 7;
+	static constexpr int32_t HEIGHT = H;
+	static constexpr int32_t WIDTH = W;
 	static constexpr int32_t BOARD_SIZE = HEIGHT * WIDTH;
 	static const int MIN_SCORE = -(WIDTH * HEIGHT) / 2 + 3;
 	static const int MAX_SCORE = (WIDTH * HEIGHT + 1) / 2 - 3;
 
-	static constexpr int32_t offsets[3] = { HEIGHT, HEIGHT + 1, HEIGHT + 2 }; // Offsets to go diagonal (down slope), horizontal, and diagonal (up slope)
+	static constexpr board COLUMN_BITS = (static_cast<board>(1) << (HEIGHT + 1)) - 1; // one column, including the extra row
 
 	// bitmask with '1' in the bottom spot of a given column
 	static constexpr board BOTTOM_MASK_COL(int col) {
@@ -71,15 +80,40 @@ public:
 		return ((static_cast<board>(1) << (HEIGHT)) - 1) << (col * (HEIGHT + 1));
 	}
 
-	int moveScore(uint64_t move) const {
+	int moveScore(board move) const {
 		return popcount(get_threats(current_mask | move) & (BOARD_MASK ^ all_mask));
 	}
 
 
-	board key() {
+	board key() const {
 		return current_mask + all_mask;
 	}
 
+	// key of the position after playing 'move', without playing it
+	board key_after(board move) const {
+		return (current_mask ^ all_mask) + (all_mask | move);
+	}
+
+	// The board is left/right symmetric: a position and its mirror image have the same score.
+	// The canonical key is the smaller of the key and the key of the mirror image, so both share one table entry.
+	board canonical_key() const {
+		board k = key();
+		return std::min(k, mirror(k));
+	}
+
+	board canonical_key_after(board move) const {
+		board k = key_after(move);
+		return std::min(k, mirror(k));
+	}
+
+	// Reverse the order of the columns of a bitboard (including the extra row)
+	static constexpr board mirror(board b) {
+		board result = 0;
+		for (int col = 0; col < WIDTH; col++)
+			result |= ((b >> col * (HEIGHT + 1)) & COLUMN_BITS) << (WIDTH - 1 - col) * (HEIGHT + 1);
+		return result;
+	}
+
 	// 'm' is a bitboard with only one bit set, and should be a legal move
 	void play_move(board m) {
 		current_mask |= m;
@@ -88,12 +122,20 @@ public:
 		nb_moves++;
 	}
 
+	// Take back 'm', the last move played: the inverse of play_move(m)
+	void undo_move(board m) {
+		current_mask ^= all_mask;
+		current_mask &= ~m;
+		all_mask &= ~m;
+		nb_moves--;
+	}
+
 	// all_mask + bottom mask is a bitmask with the first empty slot in each column set. 
 	void play_col(int col) {
 		play_move( (all_mask + BOTTOM_MASK_COL(col)) & COL_MASK(col));
 	}
 
-	void play_moves(std::string s) {
+	void play_moves(std::string_view s) {
 		for (char const& c : s) {
 			// assert(is_legal_col(col));
 			play_col( c - '0');
@@ -101,13 +143,25 @@ public:
 	}
 
 	// play moves given by columns indexed starting with '1' (to be consistent with online solver)
-	void play_moves_one_ind(std::string s) {
+	void play_moves_one_ind(std::string_view s) {
 		for (char const& c : s) {
 			// assert(is_legal_col(col));
 			play_col(c - '1');
 		}
 	}
 
+	// play moves indexed from '1', checking that each of them is legal and that the game is not over.
+	// Returns false (leaving the position partially played) otherwise.
+	bool play_moves_checked(std::string_view s) {
+		for (char const& c : s) {
+			int col = c - '1';
+			if (col < 0 || col >= WIDTH || !(get_legal() & COL_MASK(col)) || (winning_moves() & COL_MASK(col)))
+				return false;
+			play_col(col);
+		}
+		return true;
+	}
+
 	// return True if the last player who moved has connected 4 pieces
 	/*
 	bool gameover_zero() {
@@ -128,10 +182,19 @@ public:
 
 	// Return a bitmask with spots which would make 4 in a row if any one is filled. INCLUDES NON-REAL THREATS IN THE EXTRA ROW
 	board get_threats(board mask) const {
-		board result = 0;
+		board result;
+		threats(mask, result);
+		return result;
+	}
+
+	// Body of get_threats. Also instantiated on vectors of boards (one child per lane) by the SIMD kernels of MoveScorer,
+	// which is why the vectors are passed by reference.
+	template<class B>
+	C4_ALWAYS_INLINE static void threats(const B& mask, B& result) {
+		result = B{};
 		result |= (mask & mask << 1 & mask << 2) << 1; // Vertical -111
 
-		board temp = mask & mask << HEIGHT + 1; // Horizontal --11 has bits set in a '1' spot with a '1' to its left
+		B temp = mask & mask << HEIGHT + 1; // Horizontal --11 has bits set in a '1' spot with a '1' to its left
 		result |= (temp & mask << 2 * (HEIGHT + 1)) << (HEIGHT + 1); // 111-
 		result |= (temp & mask << 2 * (HEIGHT + 1)) >> 3 * (HEIGHT + 1); // -111
 		result |= (temp & mask << 3 * (HEIGHT + 1)) >> 2 * (HEIGHT + 1); // 1-11
@@ -148,14 +211,16 @@ public:
 		result |= (temp & mask << 2 * (HEIGHT)) >> 3 * (HEIGHT); // Diagonal -111
 		result |= (temp & mask << 3 * (HEIGHT)) >> 2 * (HEIGHT); // Diagonal 1-11
 		result |= (mask & temp << 2 * (HEIGHT)) >> (HEIGHT); // Diagonal 11-1
-
-		return result;
 	}
 
 
 	// Return bitmask with moves that will not lose within 2 plies. Assumes there are no immediately winning moves.
-	board nonlosing_moves() {
-		board opponent_threats = get_threats(current_mask ^ all_mask) & BOARD_MASK; // Threats on the board
+	board nonlosing_moves() const {
+		return nonlosing_moves(get_threats(current_mask ^ all_mask) & BOARD_MASK); // Threats on the board
+	}
+
+	// Same as nonlosing_moves(), given the threats of the opponent. Only their empty cells matter.
+	board nonlosing_moves(board opponent_threats) const {
 		board possible = get_legal();
 		board forced_moves = opponent_threats & possible;
 
@@ -169,106 +234,60 @@ public:
 	}
 
 	// Legal moves are those above a placed stone or at the bottom row where there are no stones currently
-	uint64_t get_legal() const {
+	board get_legal() const {
 		return (all_mask + BOTTOM_MASK) & BOARD_MASK;
 	}
 
-	const static uint64_t BOTTOM_MASK = bottom(WIDTH, HEIGHT);
-	const static uint64_t BOARD_MASK = BOTTOM_MASK * ((1LL << HEIGHT) - 1);
-
-	// 1 -> spot taken by current player
-	// 0 -> spot that is empty
-	// L -> spot that is legal to play
-	// 
-	// PART 1: double threats - That is two threat-generating pairs that share a spot
-	// A threat-generating pair for example is: 11LL. If any 'L' is played, we have a threat in the remaining 'L'. 
+	// bitmask with '1' in the bottom spot of every column
+	static constexpr board BOTTOM_MASK = [] {
+		board b = 0;
+		for (int col = 0; col < WIDTH; col++) b |= static_cast<board>(1) << col * (HEIGHT + 1);
+		return b;
+	}();
+	static constexpr board BOARD_MASK = BOTTOM_MASK * ((static_cast<board>(1) << HEIGHT) - 1);
+
+	// WIN IN 3 PLIES: after a non-losing move, the opponent has no immediate win. We win on our next move whatever
+	// they play if we then have two playable threats (they can only block one of them), or a playable threat with
+	// another threat of ours right above it (blocking the first one lets us play the second one).
 	//
-	// Step 1: Create bitmasks of threat-generating pairs, pairs separated by one spot, 2 spots, or 3 spots:
-	// sep1 group: LL11 -> 0100, 1LL1 -> 0010, 11LL -> 0001 
-	// sep2 group: L1L1 -> 0010, 1L1L -> 0001
-	// sep3 group: L11L -> 0001
-	//
-	// Step 2: Get 3 bitmasks from those 6 as follows: sep1 = disjunction of all masks in sep1 group. sep2 = disjunction of all masks in sep2 group.
-	// Reason: if we skip to the step where we find bits set in more than one mask, we would mark 2 pairs that are identical
-	// For example: 110011 will be present in the 11LL and LL11 masks, but it only counts as one threat pair, so not a double threat.
-	// That is why we compress those 6 masks into 3 masks, so we do not double-count the same threat-generating pair
-	// 
-	// Step 3: Change the sep masks to have all threat-generating spots set to 1:
-	// sep1 |= sep1 left shift by 1.	sep2 |= sep2 left shift by 2	sep3 |= sep3 shift by 3 
-	//
-	// Step 4: do steps 1 and 2 for horizontal, diagonal1 and diagonal2 threats to produce 9 masks (sep1/2/3 3 times)
-	// Step 5: produce one more mask: 11L0 -> 0010 vertical threat generator
-	// Step 6: Find any bit that is set in more than one mask. That is a double threat-generating move.
-	
-	// PART 2: win by threat-generating pair below a threat
-	/*
-	board win_in_3() {
-		board legal = get_legal();
-		board empty = BOARD_MASK & ~all_mask;
-		board opponent_immediate_threats = get_threats(current_mask ^ all_mask) & legal;
-
-		if (opponent_immediate_threats) {
-			legal &= opponent_immediate_threats; // The only move we have is to block the threat
-		}
-
-		for (int i = 0; i < 3; ++i) {
-			uint32_t offset = offsets[i];
-			board temp = legal & legal << offset;
-			threat_pair_masks[3 * i + 0] = // sep1
-				temp & (current_mask >> offset) & (current_mask >> 2 * offset) |    // LL11 -> 0100
-				temp & (current_mask << 2 * offset) & (current_mask >> offset) |    // 1LL1 -> 0010
-				temp & (current_mask << 2 * offset) & (current_mask << 3 * offset); // 11LL -> 0001
-			threat_pair_masks[3 * i + 0] |= threat_pair_masks[3 * i + 0] >> offset;
-
-			temp = legal & legal << 2 * offset;
-			threat_pair_masks[3 * i + 1] = // sep2
-				temp & (current_mask << offset) & (current_mask >> offset) |  // L1L1 -> 0010
-				temp & (current_mask << offset) & (current_mask << 3 * offset); // 1L1L -> 0001
-			threat_pair_masks[3 * i + 1] |= threat_pair_masks[3 * i + 1] >> 2 * offset;
-
-			threat_pair_masks[3 * i + 2] = legal & legal << 3 * offset & current_mask << offset & current_mask << 2 * offset; // sep3: L11L -> 0001
-			threat_pair_masks[3 * i + 2] |= threat_pair_masks[3 * i + 2] >> 3 * offset;
-		}
-		threat_pair_masks[9] = current_mask << 2 & current_mask << 1 & legal & empty >> 1; // Vertical 11L0 -> 0010
-
-		board threat_generating_masks = 0; 
-		board result = 0;
-		for (int i = 0; i < 9; ++i) {
-			result |= (threat_generating_masks & threat_pair_masks[i]);
-			threat_generating_masks |= threat_pair_masks[i];
-		}
-
-		// PART 2: win by threat-generating pair below a threat, excluding vertical threat-generator
-		board threats = get_threats(current_mask) & empty;
-		result |= (threats >> 1) & threat_generating_masks;
+	// 'move' is a non-losing move, and 'threats' the threats of the current player after playing it, among the spots
+	// that are empty before it (as computed by MoveScorer). Returns true if 'move' wins in 3 plies.
+	bool wins_in_3(board move, board threats) const {
+		board playable = threats & ((all_mask | move) + BOTTOM_MASK) & BOARD_MASK;
+		return (playable & (playable - 1)) || (threats & playable << 1);
+	}
 
-		// We skipped vertical threat-generators earlier, so we consider them now
-		result |= (threat_generating_masks & threat_pair_masks[9]);
-		threat_generating_masks |= threat_pair_masks[9];
+	static uint8_t popcount(board mask) {
+		if constexpr (sizeof(board) > sizeof(uint64_t))
+			return popcount64(static_cast<uint64_t>(mask)) + popcount64(static_cast<uint64_t>(mask >> 64));
+		else
+			return popcount64(mask);
+	}
 
-		// PART 3: Win if there is a threat, and there is only one empty spot left that is not directly below a threat.
-		// Additionally,
-		board active_threats = empty & threats;
-		if (active_threats) {
-			board playable_spots = ( (active_threats | EXTRA_ROW_MASK()) - BOTTOM_MASK) ^ active_threats; // bitmask with the threat and all spots below it
-			playable_spots &= empty & ~(active_threats | active_threats >> 1); // exclude the threat and the spot below it.
-			if (!(playable_spots & (playable_spots - 1))) { // if there is only one spot left
+	static uint8_t popcount64(uint64_t mask) {
+		#ifdef _MSC_VER
+		return (uint8_t)__popcnt64(mask);
+		#else
+		return __builtin_popcountll(mask);
+		#endif
+	}
 
-				if (opponent_immediate_threats) {
-					playable_spots &= opponent_immediate_threats; // must block the immediate threat
-				}
+	// Index of the only bit set in 'move'
+	static int bit_index(board move) {
+		if constexpr (sizeof(board) > sizeof(uint64_t))
+			return (uint64_t)move ? bit_index64((uint64_t)move) : 64 + bit_index64((uint64_t)(move >> 64));
+		else
+			return bit_index64(move);
+	}
 
-				result |= playable_spots; // then that spot is win-in-3
-			}
-		}
-		return result;
- 	}
-	*/
-	static uint8_t popcount(board mask) {
-		#ifndef _MSC_VER
-		#error "__popcount64 only defined for MSVC compiler"
+	static int bit_index64(uint64_t move) {
+		#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, move);
+		return (int)index;
+		#else
+		return __builtin_ctzll(move);
 		#endif
-		return __popcnt64(mask);
 	}
 
 	// Return the number of threats the opponent has. Includes threats that cannot be immediately played.
@@ -305,9 +324,9 @@ public:
 
 	void display_board(board b) {
 		std::string s;
-		for (int r = Position::HEIGHT - 1; r >= 0; --r) {
+		for (int r = HEIGHT - 1; r >= 0; --r) {
 			s.clear();
-			for (int c = 0; c < Position::WIDTH; ++c) {
+			for (int c = 0; c < WIDTH; ++c) {
 				if (b & get_mask(r, c)) { s += "X"; }
 				else { s += "-"; }
 			}
@@ -318,10 +337,10 @@ public:
 
 	void display_board_with_extra_row(board b) {
 		std::string s;
-		for (int r = Position::HEIGHT; r >= 0; --r) {
+		for (int r = HEIGHT; r >= 0; --r) {
 			s.clear();
-			for (int c = 0; c < Position::WIDTH; ++c) {
-				board mask = ((board)1 << (r + c * (Position::HEIGHT + 1)));
+			for (int c = 0; c < WIDTH; ++c) {
+				board mask = ((board)1 << (r + c * (HEIGHT + 1)));
 				if (b & mask) { s += "X"; }
 				else { s += "-"; }
 			}
@@ -330,4 +349,8 @@ public:
 		std::cout << "\n";
 	}
 
-};
\ No newline at end of file
+};
+
+// The standard 7x6 board
+typedef BasicPosition<7, 6> Position;
+typedef Position::board board;
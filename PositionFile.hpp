@@ -0,0 +1,97 @@
+#pragma once
+
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include "MappedFile.hpp"
+
+/**
+* Streaming reader of position files, one "<moves> <score>" line per position.
+*
+* The file is memory-mapped and parsed in place: the moves are returned as views into the mapping, and the scores
+* are parsed with from_chars, so reading a line allocates nothing. Files of millions of lines are paged in by the
+* OS as the reader advances.
+*/
+class PositionReader {
+public:
+	size_t n_malformed; // non-empty lines skipped because they are not of the form "<moves> <score>"
+
+	PositionReader() : n_malformed{ 0 }, pos{ nullptr }, end{ nullptr } {}
+
+	bool open(const std::string& filename) {
+		n_malformed = 0;
+		if (!file.open(filename)) {
+			std::cout << "Failed to open file: " << filename << "\n";
+			pos = end = nullptr;
+			return false;
+		}
+		pos = file.data;
+		end = file.data + file.size;
+		return true;
+	}
+
+	// Read the next well-formed line. Returns false at the end of the file.
+	// 'moves' stays valid as long as the reader is open.
+	bool next(std::string_view& moves, int& score) {
+		while (pos < end) {
+			const char* eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+			if (!eol) eol = end;
+			const char* line = pos;
+			pos = eol + (eol < end);
+
+			const char* space = static_cast<const char*>(memchr(line, ' ', eol - line));
+			if (!space) {
+				n_malformed += eol > line && !(eol - line == 1 && *line == '\r');
+				continue;
+			}
+			const char* number = space + 1;
+			if (number < eol && *number == '+') number++; // from_chars does not accept a leading '+'
+			if (std::from_chars(number, eol, score).ec != std::errc()) {
+				n_malformed++;
+				continue;
+			}
+			moves = std::string_view(line, space - line);
+			return true;
+		}
+		return false;
+	}
+
+private:
+	MappedFile file;
+	const char* pos;
+	const char* end;
+};
+
+/**
+* Output of the test file runs, one "<moves>, <microseconds>, <nodes>" line per position, formatted with to_chars into
+* a buffer that is written to the stream in large blocks.
+*/
+class ResultWriter {
+public:
+	static constexpr size_t BLOCK = 1 << 16;
+
+	ResultWriter(std::ostream& strm) : strm{ strm } { buffer.reserve(BLOCK + 256); }
+	~ResultWriter() { flush(); }
+
+	void write(std::string_view moves, long long microseconds, long long nodes) {
+		char number[24];
+		buffer.append(moves);
+		buffer.append(", ");
+		buffer.append(number, std::to_chars(number, number + sizeof(number), microseconds).ptr);
+		buffer.append(", ");
+		buffer.append(number, std::to_chars(number, number + sizeof(number), nodes).ptr);
+		buffer.push_back('\n');
+		if (buffer.size() >= BLOCK) flush();
+	}
+
+	void flush() {
+		strm.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+
+private:
+	std::ostream& strm;
+	std::string buffer;
+};
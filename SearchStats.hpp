@@ -0,0 +1,87 @@
+#pragma once
+
+#include <iostream>
+#include <iomanip>
+#include "Position.hpp"
+
+// Search counters are only collected when the solver is built with C4_SEARCH_STATS=1
+// (cmake -DC4_SEARCH_STATS=ON). Otherwise C4_STAT(...) expands to nothing and the hot path is unchanged.
+#if defined(C4_SEARCH_STATS) && C4_SEARCH_STATS
+#define C4_STAT(statement) statement
+#else
+#define C4_STAT(statement)
+#endif
+
+/**
+* Counters describing one search. Each Solver owns its counters, so there is one set per thread.
+*/
+template<int WIDTH, int HEIGHT>
+struct BasicSearchStats {
+	static constexpr int BOARD_SIZE = WIDTH * HEIGHT;
+
+#if defined(C4_SEARCH_STATS) && C4_SEARCH_STATS
+	static constexpr bool enabled = true;
+#else
+	static constexpr bool enabled = false;
+#endif
+
+	unsigned long long nodes_by_ply[BOARD_SIZE + 1]; // negamax calls by number of moves played
+	unsigned long long tt_probes;
+	unsigned long long tt_hits;
+	unsigned long long tt_exact_hits;  // hits with an exact score, which end the node at once
+	unsigned long long tt_overwrites;  // stores that updated an entry of the same position
+	unsigned long long tt_collisions;  // stores that evicted an entry of another position
+	unsigned long long cutoffs_by_move[WIDTH]; // beta cutoffs, by index of the move in MoveSorter order
+	unsigned long long nonlosing_exits; // nodes left early because every move loses
+	unsigned long long win_in_3_exits;  // nodes left early because a move wins in 3 plies
+	unsigned long long endgame_hits;    // nodes found in the endgame table
+	unsigned long long null_window_searches; // iterations of the alpha_beta loop
+
+	BasicSearchStats() : nodes_by_ply{}, tt_probes{ 0 }, tt_hits{ 0 }, tt_exact_hits{ 0 }, tt_overwrites{ 0 }, tt_collisions{ 0 },
+		cutoffs_by_move{}, nonlosing_exits{ 0 }, win_in_3_exits{ 0 }, endgame_hits{ 0 }, null_window_searches{ 0 } {}
+
+	void reset() { *this = BasicSearchStats(); }
+
+	unsigned long long nodes() const {
+		unsigned long long n = 0;
+		for (unsigned long long x : nodes_by_ply) n += x;
+		return n;
+	}
+
+	BasicSearchStats& operator+=(const BasicSearchStats& o) {
+		for (int i = 0; i <= BOARD_SIZE; i++) nodes_by_ply[i] += o.nodes_by_ply[i];
+		for (int i = 0; i < WIDTH; i++) cutoffs_by_move[i] += o.cutoffs_by_move[i];
+		tt_probes += o.tt_probes;
+		tt_hits += o.tt_hits;
+		tt_exact_hits += o.tt_exact_hits;
+		tt_overwrites += o.tt_overwrites;
+		tt_collisions += o.tt_collisions;
+		nonlosing_exits += o.nonlosing_exits;
+		win_in_3_exits += o.win_in_3_exits;
+		endgame_hits += o.endgame_hits;
+		null_window_searches += o.null_window_searches;
+		return *this;
+	}
+
+	void print(std::ostream& strm) const {
+		if (!enabled) return;
+		std::ios::fmtflags flags = strm.flags();
+		std::streamsize precision = strm.precision();
+		strm << "nodes: " << nodes() << ", null-window searches: " << null_window_searches << ", no non-losing move: " << nonlosing_exits
+			 << ", win in 3: " << win_in_3_exits << ", endgame table: " << endgame_hits << "\n";
+		strm << "TT probes: " << tt_probes << ", hits: " << tt_hits << " (" << std::fixed << std::setprecision(1) << (tt_probes ? 100.0 * tt_hits / tt_probes : 0) << "%)"
+			 << ", exact: " << tt_exact_hits << ", overwrites: " << tt_overwrites << ", collisions: " << tt_collisions << "\n";
+		unsigned long long cutoffs = 0;
+		for (unsigned long long x : cutoffs_by_move) cutoffs += x;
+		strm << "beta cutoffs: " << cutoffs << " (" << (cutoffs ? 100.0 * cutoffs_by_move[0] / cutoffs : 0) << "% at the first move), by move index:";
+		for (unsigned long long x : cutoffs_by_move) strm << " " << x;
+		strm << "\nnodes by ply:";
+		for (int i = 0; i <= BOARD_SIZE; i++)
+			if (nodes_by_ply[i]) strm << " " << i << ":" << nodes_by_ply[i];
+		strm << "\n";
+		strm.flags(flags);
+		strm.precision(precision);
+	}
+};
+
+typedef BasicSearchStats<Position::WIDTH, Position::HEIGHT> SearchStats;
@@ -25,38 +25,230 @@ MOVE_SCORE = (PLYSCORE / 2) round away from zero
 
 #include "Solver.hpp"
 #include "MoveSorter.hpp"
+#include "MoveScorer.hpp"
+#include "PositionFile.hpp"
+
+// Early exit of negamax when a move forces a win on the next move (see Position::wins_in_3). Set by CMake.
+#if !defined(C4_WIN_IN_3)
+#define C4_WIN_IN_3 1
+#endif
 
 // Constructor
-Solver::Solver() : nodeCount{ 0 } {
+template<int WIDTH, int HEIGHT>
+BasicSolver<WIDTH, HEIGHT>::BasicSolver() : BasicSolver(std::make_shared<TranspositionTable>()) {}
+
+template<int WIDTH, int HEIGHT>
+BasicSolver<WIDTH, HEIGHT>::BasicSolver(std::shared_ptr<TranspositionTable> table) : nodeCount{ 0 }, make_unmake{ true }, T{ table },
+    node_limit{ ULLONG_MAX }, deadline{ std::chrono::steady_clock::time_point::max() }, next_check{ ULLONG_MAX }, budget_spent{ false },
+    root_moves{ -1 }, root_best{ 0 }, book{ default_book } {
+    set_endgame(default_endgame);
     for (int i = 0; i < Position::WIDTH; i++)
         columnOrder[i] = Position::WIDTH / 2 + (1 - 2 * (i % 2)) * (i + 1) / 2;
     // initialize the column exploration order, starting with center columns
     // example for WIDTH=7: columnOrder = {3, 4, 2, 5, 1, 6, 0}
 }
 
-int32_t Solver::alpha_beta(Position& P) {
+template<int WIDTH, int HEIGHT>
+int32_t BasicSolver<WIDTH, HEIGHT>::alpha_beta(Position& P) {
+    T->new_search();
+    return alpha_beta_shared(P);
+}
+
+template<int WIDTH, int HEIGHT>
+int32_t BasicSolver<WIDTH, HEIGHT>::alpha_beta_shared(Position& P) {
+    C4_STAT(stats.reset());
+    int score;
+    if constexpr (std::is_same_v<Position, ::Position>) // the book holds positions of the standard board only
+        if (book && book->get(P, score)) return score;
 
     int min = -(Position::HEIGHT * Position::WIDTH) - 1; // -INF
     int max = Position::HEIGHT * Position::WIDTH + 1; // +INF
+    if (!history.persist) history.clear();
+    score = narrow_window(P, min, max);
+    C4_STAT(totalStats += stats);
+    return score;
+}  
+
+template<int WIDTH, int HEIGHT>
+typename BasicSolver<WIDTH, HEIGHT>::BoundedScore BasicSolver<WIDTH, HEIGHT>::alpha_beta_budget(Position& P, unsigned long long max_nodes, std::chrono::microseconds max_time) {
+    BoundedScore result;
+    result.best_col = -1;
+    if (board winning = P.winning_moves()) {
+        result.lower = result.upper = (Position::BOARD_SIZE + 1 - P.nb_moves) / 2;
+        for (int col = 0; col < Position::WIDTH; col++)
+            if (winning & Position::COL_MASK(col)) result.best_col = col;
+        return result;
+    }
+
+    // first move of the move ordering, in case no cutoff happens at the root
+    board possible = P.nonlosing_moves();
+    if (!possible) possible = P.get_legal();
+    int best_score = -1;
+    for (int i = Position::WIDTH; i--; )
+        if (board move = possible & Position::COL_MASK(columnOrder[i])) {
+            int score = P.moveScore(move);
+            if (score >= best_score) {
+                best_score = score;
+                result.best_col = columnOrder[i];
+            }
+        }
+
+    node_limit = max_nodes ? nodeCount + max_nodes : ULLONG_MAX;
+    deadline = max_time.count() ? std::chrono::steady_clock::now() + max_time : std::chrono::steady_clock::time_point::max();
+    next_check = nodeCount;
+    root_moves = P.nb_moves;
+    root_best = 0;
+
+    C4_STAT(stats.reset());
+    int min = -(Position::HEIGHT * Position::WIDTH) - 1; // -INF
+    int max = Position::HEIGHT * Position::WIDTH + 1; // +INF
+    T->new_search();
+    if (!history.persist) history.clear();
+    narrow_window(P, min, max);
+    C4_STAT(totalStats += stats);
+
+    result.lower = std::max(min, -(Position::BOARD_SIZE - P.nb_moves) / 2); // we cannot lose before the opponent's next move
+    result.upper = std::min(max, (Position::BOARD_SIZE - 1 - P.nb_moves) / 2); // nor win with this one
+    for (int col = 0; col < Position::WIDTH; col++)
+        if (root_best & Position::COL_MASK(col)) result.best_col = col;
+
+    node_limit = ULLONG_MAX;
+    deadline = std::chrono::steady_clock::time_point::max();
+    next_check = ULLONG_MAX;
+    budget_spent = false;
+    root_moves = -1;
+    return result;
+}
+
+template<int WIDTH, int HEIGHT>
+void BasicSolver<WIDTH, HEIGHT>::check_budget() {
+    if (nodeCount > node_limit || std::chrono::steady_clock::now() > deadline) {
+        budget_spent = true;
+        next_check = ULLONG_MAX;
+    }
+    else next_check = std::min(node_limit, nodeCount + 1024);
+}
+
+template<int WIDTH, int HEIGHT>
+int32_t BasicSolver<WIDTH, HEIGHT>::narrow_window(Position& P, int& min, int& max, bool outcome_only) {
     while (min < max) {                    // iteratively narrow the min-max exploration window
+        if (outcome_only && (min > 0 || max < 0)) break;
         int med = min + (max - min) / 2;
         if (med <= 0 && min / 2 < med) med = min / 2;
         else if (med >= 0 && max / 2 > med) med = max / 2;
         int r = negamax(P, med, med + 1);   // use a null depth window to know if the actual score is greater or smaller than med
+        if (abandoned()) break;             // r cannot be trusted, but the bounds proven so far still hold
+        C4_STAT(stats.null_window_searches++);
         if (r <= med) max = r;
         else min = r;
+        if (on_window) on_window(min, max);
     }
     return min;
-}  
+}
+
+template<int WIDTH, int HEIGHT>
+typename BasicSolver<WIDTH, HEIGHT>::Analysis BasicSolver<WIDTH, HEIGHT>::analyze(const Position& P, bool stop_at_best) {
+    C4_STAT(stats.reset());
+    T->new_search(); // once for all the children, so that they do not evict each other's entries first
+    if (!history.persist) history.clear();
+    Analysis A;
+    A.best_col = -1;
+    int best = 0;
+    board winning = P.winning_moves();
+    for (int i = 0; i < Position::WIDTH; i++) {
+        int col = columnOrder[i];
+        A.scores[col] = Analysis::INVALID;
+        A.exact[col] = true;
+        board move = P.get_legal() & Position::COL_MASK(col);
+        if (!move) continue;
+
+        int score;
+        Position child(P);
+        child.play_move(move);
+        if (move & winning)
+            score = (Position::BOARD_SIZE + 1 - P.nb_moves) / 2;
+        else if (child.winning_moves())
+            score = -(Position::BOARD_SIZE - P.nb_moves) / 2; // the opponent wins with their next move
+        else {
+            int child_score;
+            bool in_book = false;
+            if constexpr (std::is_same_v<Position, ::Position>)
+                in_book = book && book->get(child, child_score);
+            if (in_book) score = -child_score;
+            else {
+                int min = -(Position::HEIGHT * Position::WIDTH) - 1; // -INF
+                int max = Position::HEIGHT * Position::WIDTH + 1; // +INF
+                if (A.best_col >= 0) { // aspiration: is this move better than the best sibling, whose score is 'best'?
+                    int r = negamax(child, -best - 1, -best);
+                    C4_STAT(stats.null_window_searches++);
+                    if (r <= -best - 1) max = r;
+                    else min = r;
+                }
+                if (stop_at_best && A.best_col >= 0 && min >= -best) { // proven no better than the best move
+                    score = -min;
+                    A.exact[col] = false;
+                }
+                else score = -narrow_window(child, min, max);
+            }
+        }
+        A.scores[col] = score;
+        if (A.best_col < 0 || score > best) {
+            best = score;
+            A.best_col = col;
+        }
+    }
+    C4_STAT(totalStats += stats);
+    return A;
+}
+
+template<int WIDTH, int HEIGHT>
+int32_t BasicSolver<WIDTH, HEIGHT>::solve(Position& P) {
+    if (P.winning_moves())
+        return (Position::BOARD_SIZE + 1 - P.nb_moves) / 2;
+    return alpha_beta(P);
+}
+
+template<int WIDTH, int HEIGHT>
+int BasicSolver<WIDTH, HEIGHT>::weak_solve(Position& P) {
+    if (P.winning_moves()) return 1;
+    int score;
+    if constexpr (std::is_same_v<Position, ::Position>)
+        if (book && book->get(P, score)) return (score > 0) - (score < 0);
+
+    C4_STAT(stats.reset());
+    int min = -(Position::HEIGHT * Position::WIDTH) - 1; // -INF
+    int max = Position::HEIGHT * Position::WIDTH + 1; // +INF
+    T->new_search();
+    if (!history.persist) history.clear();
+    narrow_window(P, min, max, true);
+    C4_STAT(totalStats += stats);
+    return min > 0 ? 1 : max < 0 ? -1 : 0;
+}
 
 // Evaluation interpretation: +x means a win can be forced in x plies
 // -x means the opponent can force a win in x plies
 // 0 means neither player can force a win
-int Solver::negamax(Position &P, int alpha, int beta) {
-    
-    board possible = P.nonlosing_moves();
+template<int WIDTH, int HEIGHT>
+int BasicSolver<WIDTH, HEIGHT>::negamax(Position &P, int alpha, int beta) {
+    if (!make_unmake) return search<false>(P, alpha, beta);
+    threat_stack[P.nb_moves] = P.get_threats(P.current_mask ^ P.all_mask) & Position::BOARD_MASK;
+    return search<true>(P, alpha, beta);
+}
+
+template<int WIDTH, int HEIGHT>
+template<bool IN_PLACE>
+int BasicSolver<WIDTH, HEIGHT>::search(Position &P, int alpha, int beta) {
+    nodeCount++;
+    C4_STAT(stats.nodes_by_ply[P.nb_moves]++);
+    if (nodeCount > next_check) check_budget();
+    if (abandoned()) return 0;
+
+    board possible;
+    if constexpr (IN_PLACE) possible = P.nonlosing_moves(threat_stack[P.nb_moves]);
+    else possible = P.nonlosing_moves();
 
     if (!possible) {
+        C4_STAT(stats.nonlosing_exits++);
         return -(Position::BOARD_SIZE - P.nb_moves) / 2; // -(Position::BOARD_SIZE - P.nb_moves - 1);
     }
 
@@ -64,10 +256,19 @@ int Solver::negamax(Position &P, int alpha, int beta) {
         return 0;
     }
 
-    // board nonlosing_moves = P.nonlosing_moves();
-    //if (P.win_in_3() & nonlosing) {
-    //    return (Position::BOARD_SIZE - P.nb_moves - 2);
-    //}
+    // The root of a budgeted search does not return what the endgame table or T already know: only a cutoff there
+    // tells which move reaches the score (see alpha_beta_budget)
+    bool root = P.nb_moves == root_moves;
+
+    if (P.nb_moves >= endgame_moves && !root) { // the rest of the game may be in the endgame table
+        int score;
+        if constexpr (std::is_same_v<Position, ::Position>)
+            if (endgame && endgame->get(P, score)) {
+                C4_STAT(stats.endgame_hits++);
+                return score;
+            }
+        if (on_endgame_miss) on_endgame_miss(P);
+    }
 
     int lower_bound = -(Position::BOARD_SIZE - 2 - P.nb_moves) / 2;  // we're not losing this round so lower bound is losing in 4 plies
     if (lower_bound > alpha) {
@@ -82,76 +283,157 @@ int Solver::negamax(Position &P, int alpha, int beta) {
     }
 
     board key = P.key();
-    int val = T.get(key);
-    if (val) {
-        if (val < 0) { // we have an lower bound
-            lower_bound = val + Position::MAX_SCORE + 1;
-            if (alpha < lower_bound) {
-                alpha = lower_bound;                     // there is no need to keep beta above our max possible score.
-                if (alpha >= beta) return alpha;  // prune the exploration if the [alpha;beta] window is empty.
-            }
+    bool mirrored = Position::mirror(key) < key; // the table sees the position in its canonical orientation
+    if (mirrored) key = Position::mirror(key);
+    typename TranspositionTable::Entry entry;
+    int tt_col = TranspositionTable::NO_MOVE;
+    C4_STAT(stats.tt_probes++);
+    if (T->get(key, entry)) {
+        C4_STAT(stats.tt_hits++);
+        if (entry.lower == entry.upper && !root) {
+            C4_STAT(stats.tt_exact_hits++);
+            return entry.lower;
         }
-        else { // we have an upper bound
-            upper_bound = val - Position::MAX_SCORE - 1;
-            if (beta > upper_bound) {
-                beta = upper_bound;                     // there is no need to keep beta above our max possible score.
-                if (alpha >= beta) return beta;  // prune the exploration if the [alpha;beta] window is empty.
-            }
+        if (alpha < entry.lower && !root) {
+            alpha = entry.lower;
+            if (alpha >= beta) return alpha;  // prune the exploration if the [alpha;beta] window is empty.
+        }
+        if (beta > entry.upper && !root) {
+            beta = entry.upper;               // there is no need to keep beta above our max possible score.
+            if (alpha >= beta) return beta;
         }
+        if (entry.move != TranspositionTable::NO_MOVE)
+            tt_col = mirrored ? Position::WIDTH - 1 - entry.move : entry.move;
     }
 
-    MoveSorter moves;
+    for (board m = possible; m; m &= m - 1) // bring the table entries of the children into cache while we work on the first one
+        T->prefetch(P.canonical_key_after(m & -m));
+
+    typedef BasicMoveScorer<WIDTH, HEIGHT> MoveScorer;
+    board candidates[MoveScorer::LANES] = {};
+    int n_candidates = 0;
     for (int i = Position::WIDTH; i--; )
-        if (uint64_t move = possible & Position::COL_MASK(columnOrder[i]))
-            moves.add(move, P.moveScore(move));
+        if (board move = possible & Position::COL_MASK(columnOrder[i]))
+            candidates[n_candidates++] = move;
+
+    board threats[MoveScorer::LANES];
+    int scores[MoveScorer::LANES];
+    MoveScorer::score(P, candidates, n_candidates, threats, scores); // all the children in one pass
 
+#if C4_WIN_IN_3
+    for (int i = 0; i < n_candidates; i++) {
+        if (P.wins_in_3(candidates[i], threats[i])) {
+            C4_STAT(stats.win_in_3_exits++);
+            if (P.nb_moves == root_moves) root_best = candidates[i];
+            return upper_bound; // winning on our next move is the best we can do, since we cannot win with this one
+        }
+    }
+#endif
+
+    BasicMoveSorter<WIDTH, HEIGHT> moves;
+    board tt_move = tt_col == TranspositionTable::NO_MOVE ? 0 : possible & Position::COL_MASK(tt_col);
+    if (history.enabled())
+        for (int i = 0; i < n_candidates; i++)
+            moves.add(candidates[i], candidates[i] == tt_move ? INT_MAX : history.score(scores[i], P.nb_moves, candidates[i]));
+    else
+        for (int i = 0; i < n_candidates; i++)
+            moves.add(candidates[i], candidates[i] == tt_move ? INT_MAX : scores[i]); // the stored best move first
+
+    C4_STAT(int move_index = 0);
+    board best_move = 0; // move that raised alpha, if any
     while (board next = moves.getNext()) {
-        Position next_p(P);
-        next_p.play_move(next);
-        int score = -negamax(next_p, -beta, -alpha);
+        int score;
+        if constexpr (IN_PLACE) {
+            int i = 0;
+            while (candidates[i] != next) i++;
+            threat_stack[P.nb_moves + 1] = threats[i];
+            P.play_move(next);
+            score = -search<true>(P, -beta, -alpha);
+            P.undo_move(next);
+        }
+        else {
+            Position next_p(P);
+            next_p.play_move(next);
+            score = -search<false>(next_p, -beta, -alpha);
+        }
+        if (abandoned()) return 0; // the score of an abandoned search cannot be trusted
 
         if (score >= beta) {
-            T.put(key, score - Position::MAX_SCORE - 1); // save the lower bound of the position
+            C4_STAT(stats.cutoffs_by_move[move_index]++);
+            if (P.nb_moves == root_moves) root_best = next;
+            if (history.enabled()) history.cutoff(P.nb_moves, next);
+            store(key, score, TranspositionTable::NO_UPPER, canonical_column(next, mirrored), P.nb_moves); // save the lower bound of the position
             return score; // no need to keep iterating through the children
         }
 
         if (score > alpha) {
             alpha = score;
+            best_move = next;
         }
+        C4_STAT(move_index++);
     }
-    T.put(key, alpha + Position::MAX_SCORE + 1); // save the upper bound of the position
+    // save the upper bound of the position. If a move raised alpha, alpha is the exact score and that move is the best one.
+    store(key, best_move ? alpha : TranspositionTable::NO_LOWER, alpha, best_move ? canonical_column(best_move, mirrored) : TranspositionTable::NO_MOVE, P.nb_moves);
     return alpha;
 }
 
+template<int WIDTH, int HEIGHT>
+void BasicSolver<WIDTH, HEIGHT>::store(board key, int lower, int upper, int move, int depth) {
+    TranspositionTableBase::Store result = T->put(key, lower, upper, move, depth);
+    C4_STAT(stats.tt_overwrites += result == TranspositionTableBase::Store::Update);
+    C4_STAT(stats.tt_collisions += result == TranspositionTableBase::Store::Replace);
+    (void)result;
+}
+
 // Writes positions, time for evaluation and #positions evaluated into output stream
-void Solver::test_file(std::string filename, std::ostream &strm) {
-    std::ifstream f;
-    std::string line;
-    f.open(filename, std::fstream::in);
-    if (!f.is_open()) {
-        std::cout << "Failed to open file: " << filename << "\n";
-        return;
-    }
+template<int WIDTH, int HEIGHT>
+void BasicSolver<WIDTH, HEIGHT>::test_file(std::string filename, std::ostream &strm) {
+    PositionReader reader;
+    if (!reader.open(filename)) return;
+    ResultWriter writer(strm);
 
     auto clock = std::chrono::steady_clock();
     long long total_microseconds = 0;
-    while (std::getline(f, line)) {
+    long long total_positions = 0;
+    int n_mismatches = 0;
+    std::string_view moves;
+    int eval;
+    while (reader.next(moves, eval)) {
         auto t1 = clock.now();
-        std::size_t space_pos = line.find(" ");
-        std::string moves = line.substr(0, line.find(" "));
-        int eval = std::stoi(line.substr(space_pos + 1, line.length()));
-
-        Position p(moves);        
+        unsigned long long nodes_before = nodeCount;
+        Position p(moves);
         int move_score = alpha_beta(p);
 
-        // divide ply_score by 2 and round away from zero
         auto n_microseconds = std::chrono::duration_cast<std::chrono::microseconds>(clock.now() - t1).count();
+        long long n_positions = nodeCount - nodes_before;
         total_microseconds += n_microseconds;
-        strm << moves << ", " << n_microseconds << ", " << Position::n_positions_evaluated << "\n";
-
-        // move_score = ply_score_to_move_score(move_score);
-        assert(move_score == eval);
+        total_positions += n_positions;
+        writer.write(moves, n_microseconds, n_positions);
+        n_mismatches += move_score != eval;
     }
+    writer.flush();
     std::cout << "Total #Seconds: " << total_microseconds / 1e6 << "\n";
-    std::cout << "Total #Positions: " << Position::n_positions_evaluated << "\n";
-}
\ No newline at end of file
+    std::cout << "Total #Positions: " << total_positions << "\n";
+    if (n_mismatches) std::cout << "Mismatched scores: " << n_mismatches << "\n";
+    if (reader.n_malformed) std::cout << "Malformed lines: " << reader.n_malformed << "\n";
+    totalStats.print(std::cout);
+}
+
+template<int WIDTH, int HEIGHT>
+bool BasicSolver<WIDTH, HEIGHT>::read_test_file(const std::string& filename, std::vector<std::string>& positions, std::vector<int>& expected) {
+    PositionReader reader;
+    if (!reader.open(filename)) return false;
+    std::string_view moves;
+    int eval;
+    while (reader.next(moves, eval)) {
+        positions.emplace_back(moves);
+        expected.push_back(eval);
+    }
+    return true;
+}
+
+template class BasicSolver<7, 6>;
+template class BasicSolver<8, 7>;
+#if defined(__SIZEOF_INT128__)
+template class BasicSolver<9, 7>;
+#endif
@@ -5,17 +5,83 @@
 #include <fstream>
 #include <chrono>
 #include <algorithm>
+#include <climits>
+#include <memory>
+#include <functional>
+#include <stop_token>
+#include <type_traits>
 #include "Position.hpp"
 #include "Transposition.hpp"
+#include "OpeningBook.hpp"
+#include "EndgameTable.hpp"
+#include "SearchStats.hpp"
+#include "MoveHistory.hpp"
 
-class Solver {
+/**
+* Solver for a WIDTH x HEIGHT board. The search is compiled for each board size, so every mask and shift is a
+* constant and boards larger than 64 bits run on 128-bit integers rather than through a generic representation.
+* Solver is the standard 7x6 board. Other sizes are instantiated at the end of Solver.cpp.
+*/
+template<int WIDTH, int HEIGHT>
+class BasicSolver {
 public:
+	typedef BasicPosition<WIDTH, HEIGHT> Position;
+	typedef typename Position::board board;
+	typedef BasicTranspositionTable<WIDTH, HEIGHT> TranspositionTable;
+	typedef BasicSearchStats<WIDTH, HEIGHT> SearchStats;
+
 	unsigned long long nodeCount; // counter of explored nodes.
+	SearchStats stats;      // counters of the last alpha_beta search (only collected if SearchStats::enabled)
+	SearchStats totalStats; // sum of the counters of all the searches of this solver
 	int columnOrder[Position::WIDTH]; // column exploration order
+	BasicMoveHistory<WIDTH, HEIGHT> history; // killer and history move ordering, learned by negamax
+
+	// Search with in-place make/unmake rather than on copies of the position (see search)
+	bool make_unmake;
+	// threat_stack[n]: threats of the player who played the n-th move, among the cells empty before it. Filled by the
+	// in-place search as it plays moves, from the threats MoveScorer computed for the move. Taking a move back pops it.
+	// A node only reads the top entry, the threats of its opponent. Older entries are stale once more moves are
+	// played, and are kept only so that the top is right again after a move is taken back.
+	board threat_stack[Position::BOARD_SIZE + 1];
+
+	std::shared_ptr<TranspositionTable> T; // may be shared with other solvers running on other threads
+	std::stop_token stop; // when stop is requested, negamax unwinds without storing anything in T
+
+	// Budget of the current search (see alpha_beta_budget). negamax unwinds like on a stop request once nodeCount
+	// exceeds node_limit or the deadline has passed. Both are checked when nodeCount exceeds next_check, every 1024 nodes.
+	unsigned long long node_limit;
+	std::chrono::steady_clock::time_point deadline;
+	unsigned long long next_check; // ULLONG_MAX without a budget, so that the search only pays for one comparison
+	bool budget_spent;
+	int32_t root_moves;  // nb_moves of the root of the budgeted search, -1 otherwise
+	board root_best;     // move of the root that caused the last beta cutoff there
+
+	// If set, called by narrow_window after each null-window search with the bounds of the score proven so far
+	std::function<void(int min, int max)> on_window;
+
+	// True if the search must be abandoned: a stop was requested or the budget is spent
+	bool abandoned() const { return budget_spent || stop.stop_requested(); }
+
+	void check_budget();
+	std::shared_ptr<const OpeningBook> book; // consulted by alpha_beta before searching (7x6 only), may be null
 
-	TranspositionTable T;
+	// Book given to every new solver. Can be set at startup (see main).
+	static inline std::shared_ptr<const OpeningBook> default_book;
 
-	Solver();
+	std::shared_ptr<const EndgameTable> endgame; // probed by negamax from endgame_moves moves on (7x6 only), may be null
+	int endgame_moves;                           // INT_MAX without an endgame table
+	std::function<void(const Position&)> on_endgame_miss; // if set, called for the positions probed but not found
+
+	// Endgame table given to every new solver. Can be set at startup (see main).
+	static inline std::shared_ptr<const EndgameTable> default_endgame;
+
+	void set_endgame(std::shared_ptr<const EndgameTable> table) {
+		endgame = table;
+		endgame_moves = table && std::is_same_v<Position, ::Position> ? table->min_moves() : INT_MAX;
+	}
+
+	BasicSolver();
+	BasicSolver(std::shared_ptr<TranspositionTable> table);
 
 	board get_mask(uint32_t row, uint32_t col) {
 		assert(row <= Position::HEIGHT - 1 && row >= 0);
@@ -55,10 +121,77 @@ public:
 		return (ply_score / 2) + (ply_score % 2); // division truncates towards zero, then we add/subtract 1 if ply_score is odd.
 	}
 
+	// Returns the exact score of P. If a stop is requested the search is abandoned and the returned value is meaningless.
+	// Assumes the current player cannot win with the next move.
 	int32_t alpha_beta(Position& P);
+
+	// Same as alpha_beta, without starting a new generation of T: for solvers that share T and search the same root
+	// (Lazy SMP), so that the caller starts one generation per root and the entries of the others are not aged.
+	int32_t alpha_beta_shared(Position& P);
+
+	// Proven bounds of a score, with the best move found so far
+	struct BoundedScore {
+		int lower;
+		int upper;
+		int best_col; // -1 if there is no legal move
+		bool exact() const { return lower == upper; }
+	};
+
+	// Anytime version of solve: searches P for at most max_nodes nodes and max_time (0 for no limit). If the budget
+	// runs out, returns the interval the null-window searches completed so far have proven, and the root move that
+	// caused the last cutoff there (or the first move of the move ordering if none did).
+	BoundedScore alpha_beta_budget(Position& P, unsigned long long max_nodes, std::chrono::microseconds max_time);
+
+	// Iteratively narrow [min, max], the known bounds of the score of P, with null-window searches until the score is
+	// exact, or with outcome_only until its sign is known. If the search is abandoned, min and max keep the bounds
+	// proven so far. Returns min.
+	int32_t narrow_window(Position& P, int& min, int& max, bool outcome_only = false);
+
+	// Scores of every column of a position, for the current player
+	struct Analysis {
+		static constexpr int INVALID = -1000; // score of a full column
+		int scores[Position::WIDTH];
+		bool exact[Position::WIDTH]; // false if scores[col] is only an upper bound, no better than the score of best_col
+		int best_col;                // -1 if every column is full
+	};
+
+	// Score every legal column of P in one search: the children share this solver's table, and each of them
+	// first checks with one null window whether it beats the best sibling so far. With stop_at_best, a column
+	// proven no better than the best one is not searched further, and only gets an upper bound.
+	// P may have a winning move.
+	Analysis analyze(const Position& P, bool stop_at_best = false);
+
+	// Same as alpha_beta, but also accepts positions where the current player can win with the next move
+	int32_t solve(Position& P);
+
+	// Outcome of P for the current player: 1 for a win, 0 for a draw and -1 for a loss, whatever the number of moves.
+	// Runs the null-window searches of alpha_beta until the sign of the score is known. Searching only around 0 costs
+	// more on decisive positions, where the first windows of alpha_beta are cut short by the number of moves left.
+	// The bounds go to T like any other, so a later solve of P starts from them. P may have a winning move.
+	int weak_solve(Position& P);
 	int negamax(Position &P, int alpha, int beta);
 
-	// Go through files in a folder one at a time
+	// Body of negamax. The copy-based search visits each child on a copy of P. The in-place search plays and takes
+	// back the moves on P itself, and reads the threats of the opponent from threat_stack instead of recomputing them.
+	template<bool IN_PLACE>
+	int search(Position& P, int alpha, int beta);
+
+	// Store in T, counting overwrites and collisions
+	void store(board key, int lower, int upper, int move, int depth);
+
+	// Column of a move in the canonical orientation of the table
+	static int canonical_column(board move, bool mirrored) {
+		int col = Position::bit_index(move) / (Position::HEIGHT + 1);
+		return mirrored ? Position::WIDTH - 1 - col : col;
+	}
+
+	// Solve every line of a test file, writing "moves, microseconds, nodes" for each of them, and report the totals and
+	// the number of scores that differ from the expected ones
 	void test_file(std::string filename, std::ostream& strm);
 
-};
\ No newline at end of file
+	// Read all the lines of a test file. Returns false if the file cannot be opened.
+	static bool read_test_file(const std::string& filename, std::vector<std::string>& positions, std::vector<int>& expected);
+
+};
+
+typedef BasicSolver<Position::WIDTH, Position::HEIGHT> Solver;
@@ -0,0 +1,228 @@
+#include "SolverServer.hpp"
+
+#if !defined(_WIN32)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+SolverServer::SolverServer(unsigned int n_workers) : T{ std::make_shared<TranspositionTable>() }, stopping{ false } {
+    for (unsigned int i = 0; i < std::max(1u, n_workers); i++)
+        workers.emplace_back(&SolverServer::worker, this);
+}
+
+SolverServer::~SolverServer() {
+    {
+        std::lock_guard<std::mutex> lock(m);
+        stopping = true;
+    }
+    cv.notify_all();
+    for (auto& t : workers) t.join();
+}
+
+std::future<SolverServer::Response> SolverServer::submit(const std::string& moves, Engine engine) {
+    Job job{ moves, engine, std::chrono::steady_clock::now(), {} };
+    std::future<Response> result = job.result.get_future();
+    {
+        std::lock_guard<std::mutex> lock(m);
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+    return result;
+}
+
+void SolverServer::worker() {
+    Solver S(T);
+    DfpnSolver D;
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return stopping || !jobs.empty(); });
+            if (jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        Response r{};
+        Position p;
+        r.valid = p.play_moves_checked(job.moves);
+        if (r.valid && job.engine == Engine::Dfpn) {
+            unsigned long long nodes_before = D.nodeCount;
+            D.node_limit = D.nodeCount + dfpn_nodes;
+            DfpnSolver::Result result = D.prove_win(p);
+            r.score = result == DfpnSolver::Result::Proven;
+            r.unknown = result == DfpnSolver::Result::Unknown;
+            r.nodes = D.nodeCount - nodes_before;
+        }
+        else if (r.valid) {
+            unsigned long long nodes_before = S.nodeCount;
+            r.score = S.solve(p);
+            r.nodes = S.nodeCount - nodes_before;
+        }
+        r.microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - job.received).count();
+        job.result.set_value(r);
+    }
+}
+
+std::string SolverServer::answer(const std::string& line) {
+    size_t end = line.find_first_of(" \r");
+    std::string moves = line.substr(0, end);
+    bool win = end != std::string::npos && line.compare(end, 4, " win") == 0 && line.find_first_not_of(" \r", end + 4) == std::string::npos;
+    Response r = submit(moves, win ? Engine::Dfpn : Engine::AlphaBeta).get();
+    if (!r.valid) return moves + " error\n";
+    return moves + " " + (r.unknown ? "unknown" : std::to_string(r.score)) + " " + std::to_string(r.nodes) + " " + std::to_string(r.microseconds) + "\n";
+}
+
+void SolverServer::serve_stream(std::istream& in, std::ostream& out) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        out << answer(line) << std::flush;
+    }
+}
+
+#if !defined(_WIN32)
+
+// Buffered line reader on a socket
+class SocketLineReader {
+public:
+    int fd;
+    std::string buffer;
+
+    SocketLineReader(int fd) : fd{ fd } {}
+
+    bool getline(std::string& line) {
+        size_t end;
+        while ((end = buffer.find('\n')) == std::string::npos) {
+            char chunk[4096];
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n <= 0) return false;
+            buffer.append(chunk, n);
+        }
+        line = buffer.substr(0, end);
+        buffer.erase(0, end + 1);
+        return true;
+    }
+};
+
+static bool send_all(int fd, const std::string& s) {
+    size_t sent = 0;
+    while (sent < s.size()) {
+        ssize_t n = send(fd, s.data() + sent, s.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+static bool make_address(const std::string& path, sockaddr_un& addr) {
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cout << "Socket path too long: " << path << "\n";
+        return false;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    return true;
+}
+
+bool SolverServer::serve_socket(const std::string& path) {
+    sockaddr_un addr;
+    if (!make_address(path, addr)) return false;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 128) != 0) {
+        std::cout << "Failed to listen on socket: " << path << "\n";
+        return false;
+    }
+    std::cout << "Listening on " << path << std::endl;
+
+    while (true) { // runs until the process is stopped
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) continue;
+        std::thread([this, client] {
+            SocketLineReader reader(client);
+            std::string line;
+            while (reader.getline(line)) {
+                if (line.empty()) continue;
+                if (!send_all(client, answer(line))) break;
+            }
+            close(client);
+        }).detach();
+    }
+}
+
+void SolverServer::load_test(const std::string& path, const std::string& filename, unsigned int n_clients, size_t n_requests, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected) || positions.empty()) return;
+    if (n_requests == 0) n_requests = positions.size();
+
+    sockaddr_un addr;
+    if (!make_address(path, addr)) return;
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<int> n_mismatches{ 0 };
+    std::atomic<int> n_failures{ 0 };
+    std::vector<std::vector<long long>> latencies(n_clients);
+
+    auto client = [&](unsigned int c) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            n_failures++;
+            if (fd >= 0) close(fd);
+            return;
+        }
+        SocketLineReader reader(fd);
+        std::string line;
+        for (size_t i = next++; i < n_requests; i = next++) {
+            size_t k = i % positions.size();
+            auto t1 = std::chrono::steady_clock::now();
+            if (!send_all(fd, positions[k] + "\n") || !reader.getline(line)) {
+                n_failures++;
+                break;
+            }
+            latencies[c].push_back(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t1).count());
+
+            size_t space_pos = line.find(' ');
+            if (space_pos == std::string::npos || line.compare(space_pos + 1, 5, "error") == 0
+                || std::atoi(line.c_str() + space_pos + 1) != expected[k]) n_mismatches++;
+        }
+        close(fd);
+    };
+
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (unsigned int c = 0; c < n_clients; c++) clients.emplace_back(client, c);
+    for (auto& t : clients) t.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+
+    std::vector<long long> all;
+    for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    if (all.empty()) {
+        strm << "No request completed\n";
+        return;
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) { return all[std::min(all.size() - 1, (size_t)(p * all.size()))]; };
+
+    strm << all.size() << " requests from " << n_clients << " clients in " << seconds << "s: " << all.size() / seconds << " requests/s\n";
+    strm << "latency (us): p50 " << percentile(0.5) << ", p90 " << percentile(0.9) << ", p99 " << percentile(0.99) << ", max " << all.back() << "\n";
+    if (n_mismatches) strm << "Mismatched scores: " << n_mismatches << "\n";
+    if (n_failures) strm << "Failed connections: " << n_failures << "\n";
+}
+
+#else
+
+bool SolverServer::serve_socket(const std::string& path) {
+    std::cout << "Unix sockets are not supported on this platform\n";
+    return false;
+}
+
+void SolverServer::load_test(const std::string& path, const std::string& filename, unsigned int n_clients, size_t n_requests, std::ostream& strm) {
+    strm << "Unix sockets are not supported on this platform\n";
+}
+
+#endif
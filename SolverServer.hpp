@@ -0,0 +1,78 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <deque>
+#include <vector>
+#include "Solver.hpp"
+#include "Dfpn.hpp"
+
+/**
+* Long-running solver service. Keeps a pool of solvers sharing one TranspositionTable, so the
+* table stays warm from one request to the next.
+*
+* Protocol (one line per request and per response):
+*   request:  <moves> [win]            moves indexed from '1', anything else after a space is ignored
+*   response: <moves> <score> <nodes> <microseconds>
+*             <moves> <1|0> <nodes> <microseconds>   with 'win': 1 if the player to move can force a win (df-pn)
+*             <moves> unknown <nodes> <microseconds> with 'win', if df-pn spent its node budget (dfpn_nodes)
+*             <moves> error            if the moves are illegal or the game is already over
+*
+* Requests come from a stream (for example stdin) or from clients of a local Unix socket.
+* Each client connection is served by its own thread, which hands the positions to the worker pool
+* and answers its requests in order.
+*/
+class SolverServer {
+public:
+	enum class Engine {
+		AlphaBeta, // exact score
+		Dfpn,      // win or not, see DfpnSolver
+	};
+
+	struct Response {
+		bool valid;
+		int score;     // 1 for a win and 0 otherwise with Engine::Dfpn
+		bool unknown;  // Engine::Dfpn spent its node budget without an answer
+		unsigned long long nodes;
+		long long microseconds; // from the time the request was received, including queueing
+	};
+
+	// Nodes a df-pn request may search before it is answered with 'unknown'. Can be changed at startup (see main).
+	static inline unsigned long long dfpn_nodes = 10000000;
+
+	SolverServer(unsigned int n_workers);
+	~SolverServer();
+
+	// Solve one request on the worker pool
+	std::future<Response> submit(const std::string& moves, Engine engine = Engine::AlphaBeta);
+
+	// Answer the requests read from 'in' until it is closed
+	void serve_stream(std::istream& in, std::ostream& out);
+
+	// Accept clients on a Unix socket until the process is stopped. Returns false if the socket cannot be created.
+	bool serve_socket(const std::string& path);
+
+	// Connect n_clients to a server listening on 'path', send it the lines of a test file (n_requests in total),
+	// and report throughput and latency percentiles
+	static void load_test(const std::string& path, const std::string& filename, unsigned int n_clients, size_t n_requests, std::ostream& strm);
+
+private:
+	struct Job {
+		std::string moves;
+		Engine engine;
+		std::chrono::steady_clock::time_point received;
+		std::promise<Response> result;
+	};
+
+	std::shared_ptr<TranspositionTable> T;
+	std::vector<std::thread> workers;
+	std::deque<Job> jobs;
+	std::mutex m;
+	std::condition_variable cv;
+	bool stopping;
+
+	void worker();
+	std::string answer(const std::string& line);
+};
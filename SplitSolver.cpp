@@ -0,0 +1,381 @@
+#include "SplitSolver.hpp"
+
+#if !defined(_WIN32)
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <unistd.h>
+
+static bool send_all(int fd, const std::string& s) {
+    size_t sent = 0;
+    while (sent < s.size()) {
+        ssize_t n = send(fd, s.data() + sent, s.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += n;
+    }
+    return true;
+}
+
+SplitSolver::SplitSolver(unsigned int n_workers, int split_depth) : split_depth{ split_depth } {
+    for (unsigned int i = 0; i < std::max(1u, n_workers); i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) break;
+        std::cout.flush(); // or the child would write the buffered output again
+        int pid = fork();
+        if (pid == 0) {
+            for (Worker& w : workers) close(w.fd); // so that each worker sees the end of its own connection only
+            close(fds[0]);
+            worker_main(fds[1]);
+            _exit(0);
+        }
+        close(fds[1]);
+        if (pid < 0) {
+            close(fds[0]);
+            break;
+        }
+        workers.push_back(Worker{ pid, fds[0], "", -1, false, 0, 0, {} });
+    }
+    if (workers.empty()) std::cout << "Failed to start the worker processes\n";
+}
+
+SplitSolver::~SplitSolver() {
+    for (Worker& w : workers)
+        if (w.fd >= 0) close(w.fd); // the worker exits at the end of its connection
+    for (Worker& w : workers) waitpid(w.pid, nullptr, 0);
+}
+
+// Worker process: search the positions received on fd one at a time, on a table that stays warm between them.
+// Each search is a narrow_window between the bounds of the window it is given: its result only needs to be exact
+// inside the window. The bounds it reports are its raw min and max, of which the coordinator keeps what was proven.
+void SplitSolver::worker_main(int fd) {
+    Solver S;
+    std::mutex write_mutex;
+    auto send_line = [&](const std::string& s) {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        send_all(fd, s);
+    };
+
+    std::stop_source stop;
+    std::thread search; // runs the current search, while this thread listens for cancellations
+    long current = -1;
+    std::string buffer;
+    char chunk[4096];
+    ssize_t n;
+    while ((n = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+        buffer.append(chunk, n);
+        size_t end;
+        while ((end = buffer.find('\n')) != std::string::npos) {
+            std::istringstream line(buffer.substr(0, end));
+            buffer.erase(0, end + 1);
+            char type;
+            long id;
+            line >> type >> id;
+            if (type == 'S') {
+                Position P;
+                int alpha, beta;
+                line >> P.current_mask >> P.all_mask >> P.nb_moves >> alpha >> beta;
+                if (search.joinable()) search.join();
+                current = id;
+                stop = std::stop_source();
+                S.stop = stop.get_token();
+                S.on_window = [&send_line, id](int min, int max) {
+                    send_line("B " + std::to_string(id) + " " + std::to_string(min) + " " + std::to_string(max) + "\n");
+                };
+                search = std::thread([&S, &send_line, P, alpha, beta, id]() mutable {
+                    unsigned long long nodes_before = S.nodeCount;
+                    int min = alpha, max = beta, score;
+                    if (S.book && S.book->get(P, score)) min = max = score;
+                    else S.narrow_window(P, min, max);
+                    std::string nodes = std::to_string(S.nodeCount - nodes_before);
+                    if (S.abandoned()) send_line("X " + std::to_string(id) + " " + nodes + "\n");
+                    else send_line("D " + std::to_string(id) + " " + std::to_string(min) + " " + std::to_string(max) + " " + nodes + "\n");
+                });
+            }
+            else if (type == 'C' && id == current) stop.request_stop();
+            else if (type == 'N') S.T->new_search(); // one generation per root, shared by all its frontier positions
+        }
+    }
+    if (search.joinable()) {
+        stop.request_stop();
+        search.join();
+    }
+    close(fd);
+}
+
+// Add P and the positions that follow it, up to split_depth moves after the root, to the tree. Positions
+// of the frontier are appended to 'frontier' in depth-first order. Returns the node of P.
+uint32_t SplitSolver::expand(const Position& P, int max_moves, std::vector<uint32_t>& frontier) {
+    board key = P.canonical_key();
+    auto it = index.find(key);
+    if (it != index.end()) return it->second;
+
+    uint32_t n = (uint32_t)nodes.size();
+    index[key] = n;
+    nodes.push_back(Node{ P, -(Position::BOARD_SIZE - P.nb_moves) / 2, (Position::BOARD_SIZE + 1 - P.nb_moves) / 2, {}, {}, false, 0, 0, false, false });
+    if (P.winning_moves()) nodes[n].lower = nodes[n].upper = (Position::BOARD_SIZE + 1 - P.nb_moves) / 2;
+    else if (P.nb_moves == Position::BOARD_SIZE) nodes[n].lower = nodes[n].upper = 0;
+    else if (P.nb_moves >= max_moves) frontier.push_back(n);
+    else {
+        for (int i = 0; i < Position::WIDTH; i++) {
+            int col = Position::WIDTH / 2 + (1 - 2 * (i % 2)) * (i + 1) / 2; // center columns first, as the search does
+            board move = P.get_legal() & Position::COL_MASK(col);
+            if (!move) continue;
+            Position child(P);
+            child.play_move(move);
+            uint32_t c = expand(child, max_moves, frontier);
+            if (std::find(nodes[n].children.begin(), nodes[n].children.end(), c) != nodes[n].children.end()) continue; // mirror image of a sibling
+            nodes[n].children.push_back(c);
+            nodes[c].parents.push_back(n);
+        }
+        int lower = INT_MIN, upper = INT_MIN;
+        for (uint32_t c : nodes[n].children) {
+            lower = std::max(lower, -nodes[c].upper);
+            upper = std::max(upper, -nodes[c].lower);
+        }
+        nodes[n].lower = lower;
+        nodes[n].upper = upper;
+    }
+    return n;
+}
+
+// Narrow the bounds of a frontier position, and update its ancestors
+void SplitSolver::set_bounds(uint32_t leaf, int lower, int upper) {
+    nodes[leaf].lower = std::max(nodes[leaf].lower, lower);
+    nodes[leaf].upper = std::min(nodes[leaf].upper, upper);
+    std::vector<uint32_t> changed{ leaf };
+    while (!changed.empty()) {
+        uint32_t c = changed.back();
+        changed.pop_back();
+        for (uint32_t p : nodes[c].parents) {
+            int lower = INT_MIN, upper = INT_MIN;
+            for (uint32_t s : nodes[p].children) {
+                lower = std::max(lower, -nodes[s].upper);
+                upper = std::max(upper, -nodes[s].lower);
+            }
+            if (lower != nodes[p].lower || upper != nodes[p].upper) {
+                nodes[p].lower = lower;
+                nodes[p].upper = upper;
+                changed.push_back(p);
+            }
+        }
+    }
+}
+
+// Alpha-beta over the tree of the coordinator. Like Solver::narrow_window, the root is searched with a null window
+// around a guess between its bounds, moved once the bounds settle it. Each needed node gives its children the window
+// [-beta, -alpha] where its own score still matters, narrowed by its bounds. A child is needed if its bounds do not
+// settle it in the union of the windows of its needed parents.
+void SplitSolver::mark_needed() {
+    const int INF = Position::BOARD_SIZE + 1;
+    for (Node& n : nodes) {
+        n.needed = false;
+        n.alpha = INF; // empty window: no needed parent
+        n.beta = -INF;
+    }
+    int min = nodes[0].lower, max = nodes[0].upper;
+    int med = min + (max - min) / 2;
+    if (med <= 0 && min / 2 < med) med = min / 2;
+    else if (med >= 0 && max / 2 > med) med = max / 2;
+    nodes[0].alpha = med;
+    nodes[0].beta = med + 1;
+    for (uint32_t i : by_moves) { // parents before their children
+        Node& n = nodes[i];
+        n.needed = n.lower < n.upper && n.alpha < n.beta && n.lower < n.beta && n.upper > n.alpha;
+        if (!n.needed) continue;
+        int alpha = std::max(n.alpha, n.lower), beta = std::min(n.beta, n.upper);
+        for (uint32_t c : n.children) {
+            nodes[c].alpha = std::min(nodes[c].alpha, -beta);
+            nodes[c].beta = std::max(nodes[c].beta, -alpha);
+        }
+    }
+}
+
+// Send the next needed position of w's queue to w. When w's queue is empty, steal the back half of the longest one,
+// and when they are all empty, queue again the positions that the moving root window needs again.
+bool SplitSolver::next_job(Worker& w, Report& report) {
+    while (true) {
+        while (!w.queue.empty()) {
+            uint32_t n = w.queue.front();
+            w.queue.pop_front();
+            Node& node = nodes[n];
+            if (!node.needed || node.searching) continue;
+            w.alpha = std::max(node.alpha, node.lower);
+            w.beta = std::min(node.beta, node.upper);
+            if (!send_all(w.fd, "S " + std::to_string(n) + " " + std::to_string(node.P.current_mask) + " " + std::to_string(node.P.all_mask)
+                                + " " + std::to_string(node.P.nb_moves) + " " + std::to_string(w.alpha) + " " + std::to_string(w.beta) + "\n")) {
+                w.queue.push_front(n);
+                return false;
+            }
+            w.job = n;
+            node.searching = true;
+            node.searched = true;
+            return true;
+        }
+
+        Worker* victim = nullptr;
+        for (Worker& v : workers)
+            if (!victim || v.queue.size() > victim->queue.size()) victim = &v;
+        if (!victim->queue.empty()) {
+            size_t half = (victim->queue.size() + 1) / 2;
+            w.queue.assign(victim->queue.end() - half, victim->queue.end());
+            victim->queue.erase(victim->queue.end() - half, victim->queue.end());
+            report.steals++;
+            continue;
+        }
+
+        for (uint32_t n : frontier)
+            if (nodes[n].needed && !nodes[n].searching) w.queue.push_back(n);
+        if (w.queue.empty()) return false;
+    }
+}
+
+// Handle the messages of w. Returns false if its connection is closed.
+bool SplitSolver::receive(Worker& w, Report& report) {
+    char chunk[4096];
+    ssize_t n = recv(w.fd, chunk, sizeof(chunk), 0);
+    if (n <= 0) return false;
+    w.buffer.append(chunk, n);
+    size_t end;
+    while ((end = w.buffer.find('\n')) != std::string::npos) {
+        std::istringstream line(w.buffer.substr(0, end));
+        w.buffer.erase(0, end + 1);
+        char type;
+        uint32_t id;
+        line >> type >> id;
+        if (type == 'B' || type == 'D') {
+            int min, max;
+            line >> min >> max;
+            // min and max start at the bounds of the window, and are only proven once a null window moved them
+            set_bounds(id, min > w.alpha ? min : INT_MIN, max < w.beta ? max : INT_MAX);
+            if (type == 'B') continue;
+        }
+        unsigned long long searched;
+        line >> searched;
+        if (type == 'D') report.solved++;
+        else report.cancelled++;
+        report.nodes += searched;
+        nodes[id].searching = false;
+        w.job = -1;
+        w.cancelling = false;
+    }
+    return true;
+}
+
+int32_t SplitSolver::solve(const Position& P, Report& report) {
+    report = Report{};
+    nodes.clear();
+    index.clear();
+    frontier.clear();
+    expand(P, P.nb_moves + split_depth, frontier);
+    by_moves.resize(nodes.size());
+    for (uint32_t i = 0; i < nodes.size(); i++) by_moves[i] = i;
+    std::stable_sort(by_moves.begin(), by_moves.end(), [&](uint32_t a, uint32_t b) { return nodes[a].P.nb_moves < nodes[b].P.nb_moves; });
+    report.frontier = frontier.size();
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].queue.assign(frontier.begin() + i * frontier.size() / workers.size(), frontier.begin() + (i + 1) * frontier.size() / workers.size());
+    for (Worker& w : workers)
+        if (w.fd >= 0) send_all(w.fd, "N\n");
+
+    std::vector<pollfd> fds;
+    while (true) {
+        mark_needed();
+        fds.clear();
+        for (Worker& w : workers) {
+            if (w.fd < 0) continue;
+            if (w.job >= 0 && !nodes[w.job].needed && !w.cancelling)
+                w.cancelling = send_all(w.fd, "C " + std::to_string(w.job) + "\n");
+            if (w.job < 0) next_job(w, report);
+            if (w.job >= 0) fds.push_back(pollfd{ w.fd, POLLIN, 0 });
+        }
+        if (fds.empty()) break;
+        if (poll(fds.data(), fds.size(), -1) < 0) continue;
+
+        for (const pollfd& f : fds) {
+            if (!f.revents) continue;
+            Worker& w = *std::find_if(workers.begin(), workers.end(), [&](const Worker& v) { return v.fd == f.fd; });
+            if (receive(w, report)) continue;
+            std::cout << "Worker process " << w.pid << " exited\n";
+            close(w.fd);
+            w.fd = -1;
+            Worker* heir = nullptr; // another worker takes its positions
+            for (Worker& v : workers)
+                if (v.fd >= 0) heir = &v;
+            if (heir) heir->queue.insert(heir->queue.end(), w.queue.begin(), w.queue.end());
+            if (w.job >= 0) nodes[w.job].searching = false;
+            w.queue.clear();
+            w.job = -1;
+        }
+    }
+    for (Worker& w : workers) w.queue.clear();
+    for (uint32_t n : frontier) report.skipped += !nodes[n].searched;
+    if (nodes[0].lower < nodes[0].upper) std::cout << "No worker process left, the score is not exact\n";
+    return nodes[0].lower;
+}
+
+#else
+
+SplitSolver::SplitSolver(unsigned int n_workers, int split_depth) : split_depth{ split_depth } {
+    std::cout << "Worker processes are not supported on this platform\n";
+}
+
+SplitSolver::~SplitSolver() {}
+
+int32_t SplitSolver::solve(const Position& P, Report& report) {
+    report = Report{};
+    Solver S;
+    Position p(P);
+    int32_t score = S.solve(p);
+    report.nodes = S.nodeCount;
+    return score;
+}
+
+#endif
+
+void SplitSolver::benchmark(const std::string& filename, unsigned int n_workers, int split_depth, size_t max_lines, std::ostream& strm) {
+    std::vector<std::string> positions;
+    std::vector<int> expected;
+    if (!Solver::read_test_file(filename, positions, expected)) return;
+    if (max_lines && positions.size() > max_lines) positions.resize(max_lines);
+
+    SplitSolver split(n_workers, split_depth); // before the reference run allocates its table
+    if (!split.ok()) return;
+
+    auto clock = std::chrono::steady_clock();
+    std::vector<int> reference(positions.size());
+    double reference_seconds;
+    {
+        Solver S;
+        auto t1 = clock.now();
+        for (size_t i = 0; i < positions.size(); i++) {
+            Position p(positions[i]);
+            reference[i] = S.solve(p);
+        }
+        reference_seconds = std::chrono::duration<double>(clock.now() - t1).count();
+        strm << "alpha_beta: " << reference_seconds << "s, " << S.nodeCount << " nodes\n";
+    }
+
+    Report total{};
+    int n_different = 0;
+    auto t1 = clock.now();
+    for (size_t i = 0; i < positions.size(); i++) {
+        Position p(positions[i]);
+        Report r;
+        n_different += split.solve(p, r) != reference[i];
+        total.frontier += r.frontier;
+        total.solved += r.solved;
+        total.cancelled += r.cancelled;
+        total.skipped += r.skipped;
+        total.steals += r.steals;
+        total.nodes += r.nodes;
+    }
+    double seconds = std::chrono::duration<double>(clock.now() - t1).count();
+    strm << split.workers.size() << " worker processes, split depth " << split_depth << ": " << seconds << "s, " << total.nodes << " nodes, speedup "
+         << reference_seconds / seconds << (n_different ? ", DIFFERENT SCORES: " + std::to_string(n_different) : ", identical scores") << "\n";
+    strm << "frontier positions: " << total.frontier << ", solved " << total.solved << ", cancelled " << total.cancelled
+         << ", never searched " << total.skipped << ", steals " << total.steals << "\n";
+
+    int n_mismatches = 0;
+    for (size_t i = 0; i < positions.size(); i++) n_mismatches += reference[i] != expected[i];
+    if (n_mismatches) strm << "Mismatched scores: " << n_mismatches << "\n";
+}
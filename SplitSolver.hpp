@@ -0,0 +1,90 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include "Solver.hpp"
+
+/**
+* Multi-process solver for positions too expensive for one process: each worker process has its own
+* TranspositionTable, so the memory of the search grows with the number of workers.
+*
+* The coordinator expands the tree from the root to 'split_depth' moves, merging positions with the same
+* canonical key, and hands the positions of the frontier to the workers over local socket pairs. The frontier
+* is split in contiguous runs of the depth-first order, one per worker, so that each table sees related
+* positions. A worker that runs out of positions steals the back half of the longest remaining run.
+*
+* The coordinator runs alpha-beta over its tree: each frontier position is searched in the window where its score
+* still matters to the root. Workers report the bounds proven by each null-window search as they go. The coordinator
+* propagates them up the tree, and cancels the searches that can no longer change the score of the root.
+*
+* Protocol (one line per message):
+*   coordinator -> worker:  S <id> <current_mask> <all_mask> <nb_moves> <alpha> <beta>   search a position in a window
+*                           C <id>                                                       cancel it
+*                           N                                                            the next searches are for a new root
+*   worker -> coordinator:  B <id> <min> <max>                                           bounds after a null window
+*                           D <id> <min> <max> <nodes>                                   done (see worker_main)
+*                           X <id> <nodes>                                               cancelled
+*/
+class SplitSolver {
+public:
+	struct Report {
+		size_t frontier;  // positions of the frontier, after merging transpositions
+		size_t solved;    // searches completed by the workers
+		size_t cancelled; // searches cancelled since they could no longer change the score
+		size_t skipped;   // frontier positions never searched, since they could not change the score
+		size_t steals;
+		unsigned long long nodes; // nodes searched by the workers
+	};
+
+	int split_depth; // moves expanded by the coordinator before handing positions to the workers
+
+	// Start n_workers worker processes. Should be created before the process starts any thread.
+	SplitSolver(unsigned int n_workers, int split_depth);
+	~SplitSolver(); // stops the workers
+
+	bool ok() const { return !workers.empty(); }
+
+	// Exact score of P (P may have a winning move)
+	int32_t solve(const Position& P, Report& report);
+
+	// Solve the first max_lines positions of a test file (0 for all) with one Solver, then with n_workers
+	// worker processes, and report both runs and whether the scores are identical
+	static void benchmark(const std::string& filename, unsigned int n_workers, int split_depth, size_t max_lines, std::ostream& strm);
+
+private:
+	struct Node {
+		Position P;
+		int lower, upper;
+		std::vector<uint32_t> children;
+		std::vector<uint32_t> parents;
+		bool needed;     // unresolved, and can still change the score of the root
+		int alpha, beta; // window of the score that matters to the needed parents (see mark_needed)
+		bool searching;  // a worker is searching this position
+		bool searched;
+	};
+
+	struct Worker {
+		int pid;
+		int fd;
+		std::string buffer;   // received data not yet split into lines
+		int job;              // node being searched, -1 if idle
+		bool cancelling;
+		int alpha, beta;      // window of the current search
+		std::deque<uint32_t> queue; // frontier positions assigned to this worker, not yet sent
+	};
+
+	std::vector<Worker> workers;
+	std::vector<Node> nodes;
+	std::unordered_map<board, uint32_t> index; // node of each canonical key
+	std::vector<uint32_t> by_moves; // nodes by increasing number of moves: parents before their children
+	std::vector<uint32_t> frontier; // positions searched by the workers, in depth-first order
+
+	uint32_t expand(const Position& P, int max_moves, std::vector<uint32_t>& frontier);
+	void set_bounds(uint32_t leaf, int lower, int upper);
+	void mark_needed();
+	bool next_job(Worker& w, Report& report);
+	bool receive(Worker& w, Report& report);
+
+	static void worker_main(int fd);
+};
@@ -1,42 +1,293 @@
 #pragma once
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 #include "Position.hpp"
 
-class TranspositionTable {
-private:
-	// 4048831 8388617 32452867  67867979  122949829
-	static constexpr uint64_t TABLE_SIZE = 8388617; // Observation: Larger tables run slower
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+#if defined(_MSC_VER)
+#include <malloc.h>
+#include <xmmintrin.h>
+#endif
 
+/**
+* Constants and startup settings shared by the transposition tables of every board size.
+*/
+class TranspositionTableBase {
 public:
+	static constexpr int BUCKET_SIZE = 8;
+
+	// Size used by the default constructor. Can be changed at startup (see main).
+	static inline size_t default_bytes = 64 << 20;
+	static inline bool default_huge_pages = false;
+
 	// By Chinese Remainder Theorem, for any position P < 2^49
-	// the pair: r1 = P % TABLE_SIZE and r2 = P % 2^32 correspond to a unique position P, as long as P <  TABLE_SIZE * 2^32 
-	// Therefore, minimum table size is 2^17 = 131,072
-	uint32_t* K; // Only last 32 bits kept from 64-bit key. 
-	int8_t* V;
+	// the pair: r1 = P % n_buckets and r2 = P % 2^32 correspond to a unique position P, as long as P < n_buckets * 2^32
+	// and n_buckets is odd. Therefore, minimum number of buckets is the first odd number above 2^17: 131,073 (8 MB).
+	// Being odd, it is never rounded down below 2^17 by the constructor.
+	static constexpr uint64_t MIN_BUCKETS = (1 << 17) + 1;
+
+	struct alignas(64) Bucket {
+		std::atomic<uint64_t> entries[BUCKET_SIZE];
+	};
+
+	// Snapshot file: this header followed by the raw buckets (native byte order)
+	struct SnapshotHeader {
+		char magic[8];
+		uint32_t version;
+		uint8_t width;
+		uint8_t height;
+		uint8_t bucket_size;
+		uint8_t generation;
+		uint64_t n_buckets;
+		uint64_t unused;
+	};
+	static constexpr char SNAPSHOT_MAGIC[8] = { 'C', '4', 'T', 'T', 'S', 'N', 'A', 'P' };
+	static constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+	// Bounds are stored as score + BOUND_OFFSET, so that 0 means no bound
+	static constexpr int BOUND_OFFSET = 64;
+	static constexpr int NO_LOWER = -BOUND_OFFSET; // below any score
+	static constexpr int NO_UPPER = BOUND_OFFSET;  // above any score
+	static constexpr int NO_MOVE = -1;
+
+	// What get() found for a position: bounds of its score (NO_LOWER or NO_UPPER if unknown), and the column of the
+	// best move found for it, or of the move that refuted the window (NO_MOVE if unknown), in the canonical orientation
+	struct Entry {
+		int lower;
+		int upper;
+		int move;
+	};
+
+	enum class Store { Empty, Update, Replace }; // what put() wrote over: an empty entry, the same position, another position
+};
+
+/**
+* Transposition table made of buckets of 8 entries, each bucket filling exactly one 64-byte cache line.
+* A probe therefore touches a single cache line, which negamax prefetches before visiting a child.
+*
+* Entry layout (64 bits): key (32) | move (4) | generation (6) | depth (6) | lower (8) | upper (8)
+* - depth is the number of moves played in the position. Positions with fewer moves have larger subtrees.
+* - generation is bumped at every new root search (modulo 64), so entries left over from previous searches are evicted first.
+* - lower and upper bound the score, and are equal when it is exact. A store for a position already in the table
+*   merges its bounds with the stored ones, so the lower and upper bounds found by successive null-window searches
+*   end up in the same entry.
+* - move is 1 + the column of the best move (or the move that caused a cutoff), 0 if unknown.
+*
+* Entries are read and written with one relaxed atomic access, so several threads can share the table
+* without locks: a reader sees either an old or a new entry, never the key of one and the value of another.
+*
+* Keys of boards up to 49 bits (7x6 included) are checked exactly, see MIN_BUCKETS. Keys of larger boards are
+* first hashed to 64 bits, so two positions share an entry with a probability of about 2^-32 per probe.
+*/
+template<int WIDTH, int HEIGHT>
+class BasicTranspositionTable : public TranspositionTableBase {
+public:
+	typedef typename BasicPosition<WIDTH, HEIGHT>::board board;
+
+	static constexpr bool EXACT_KEYS = WIDTH * (HEIGHT + 1) <= 49;
+
+private:
+	Bucket* buckets;
+	uint64_t n_buckets;
+	size_t n_bytes;    // size of the allocation, rounded up to the page size used
+	bool mapped;       // allocated with mmap rather than aligned malloc
+	std::atomic<uint8_t> generation;
+
+	static_assert(WIDTH < 16 && WIDTH * HEIGHT < 64, "board too large for the entry layout");
+
+	static uint32_t entry_key(uint64_t e) { return (uint32_t)(e >> 32); }
+	static int entry_move(uint64_t e) { return (int)(e >> 28 & 0xF) - 1; }
+	static uint8_t entry_generation(uint64_t e) { return (uint8_t)(e >> 22 & 0x3F); }
+	static uint8_t entry_depth(uint64_t e) { return (uint8_t)(e >> 16 & 0x3F); }
+	static int entry_lower(uint64_t e) { return (int)(e >> 8 & 0xFF) - BOUND_OFFSET; }  // NO_LOWER if unknown
+	static int entry_upper(uint64_t e) { return e & 0xFF ? (int)(e & 0xFF) - BOUND_OFFSET : NO_UPPER; }
+
+	// 64-bit hash of a key, selecting the bucket. Identity for the keys that fit the exact scheme.
+	static uint64_t hash(board key) {
+		if constexpr (EXACT_KEYS) return key;
+		else if constexpr (sizeof(board) > sizeof(uint64_t))
+			return ((uint64_t)key ^ (uint64_t)(key >> 64) * 0xC2B2AE3D27D4EB4FULL) * 0x9E3779B97F4A7C15ULL;
+		else return key * 0x9E3779B97F4A7C15ULL;
+	}
+
+	// 32 bits of the hash stored in the entry: the part of the key not implied by the bucket index
+	static uint32_t check(uint64_t h) { return EXACT_KEYS ? (uint32_t)h : (uint32_t)(h >> 32); }
+
+	Bucket& bucket(uint64_t h) const { return buckets[h % n_buckets]; }
+
+	void allocate(bool huge_pages) {
+		mapped = false;
+#if defined(__linux__)
+		constexpr size_t HUGE_PAGE = 2 << 20;
+		size_t rounded = (n_bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+		void* p = MAP_FAILED;
+		if (huge_pages) // explicit huge pages, only available if the system reserved some
+			p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p == MAP_FAILED) {
+			p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (p != MAP_FAILED && huge_pages) madvise(p, rounded, MADV_HUGEPAGE); // transparent huge pages
+		}
+		if (p != MAP_FAILED) { // anonymous mappings are already zeroed
+			buckets = static_cast<Bucket*>(p);
+			n_bytes = rounded;
+			mapped = true;
+			return;
+		}
+#endif
+#if defined(_MSC_VER)
+		buckets = static_cast<Bucket*>(_aligned_malloc(n_bytes, alignof(Bucket)));
+#else
+		buckets = static_cast<Bucket*>(std::aligned_alloc(alignof(Bucket), n_bytes));
+#endif
+		memset(static_cast<void*>(buckets), 0, n_bytes);
+	}
+
+public:
+	// Build a table using at most 'bytes' of memory (but at least MIN_BUCKETS buckets)
+	BasicTranspositionTable(size_t bytes = default_bytes, bool huge_pages = default_huge_pages) : generation{ 0 } {
+		n_buckets = std::max<uint64_t>(bytes / sizeof(Bucket), MIN_BUCKETS);
+		n_buckets -= (n_buckets % 2 == 0); // odd number of buckets, see above (MIN_BUCKETS is odd already)
+		n_bytes = n_buckets * sizeof(Bucket);
+		allocate(huge_pages);
+	}
 
-	TranspositionTable() {
-		K = new uint32_t[TABLE_SIZE];
-		V = new int8_t[TABLE_SIZE];
+	BasicTranspositionTable(const BasicTranspositionTable&) = delete;
+	BasicTranspositionTable& operator=(const BasicTranspositionTable&) = delete;
 
-		memset(K, 0, TABLE_SIZE * sizeof(uint32_t));
-		memset(V, 0, TABLE_SIZE * sizeof(int8_t));
+	~BasicTranspositionTable() {
+#if defined(__linux__)
+		if (mapped) { munmap(buckets, n_bytes); return; }
+#endif
+#if defined(_MSC_VER)
+		_aligned_free(buckets);
+#else
+		std::free(buckets);
+#endif
 	}
 
-	~TranspositionTable() {
-		delete[] K;
-		delete[] V;
+	uint64_t size() const { return n_buckets * BUCKET_SIZE; } // number of entries
+	size_t bytes() const { return n_buckets * sizeof(Bucket); }
+
+	// Entries from previous searches become the first candidates for replacement
+	void new_search() {
+		generation.fetch_add(1, std::memory_order_relaxed);
 	}
 
-	void put(uint64_t key, int val) {
-		uint64_t ind = key % TABLE_SIZE;
-		K[ind] = key; // key is truncated to 32 bits
-		V[ind] = val;
+	void clear() {
+		memset(static_cast<void*>(buckets), 0, bytes());
 	}
 
-	int8_t get(uint64_t key) {
-		uint64_t ind = key % TABLE_SIZE;
-		if (K[ind] == (uint32_t)key) {
-			return V[ind];
+	// Write the whole table to a file, so that a later process can start warm.
+	bool save(const std::string& filename) const {
+		std::ofstream out(filename, std::ios::binary);
+		if (!out.is_open()) {
+			std::cout << "Failed to open file: " << filename << "\n";
+			return false;
+		}
+		SnapshotHeader h{};
+		memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+		h.version = SNAPSHOT_VERSION;
+		h.width = WIDTH;
+		h.height = HEIGHT;
+		h.bucket_size = BUCKET_SIZE;
+		h.generation = generation.load(std::memory_order_relaxed) & 0x3F;
+		h.n_buckets = n_buckets;
+		out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+		out.write(reinterpret_cast<const char*>(buckets), bytes());
+		return out.good();
+	}
+
+	// Read a snapshot written by save(). The snapshot must come from a table of the same size.
+	// The table must not be in use by any search while loading.
+	bool load(const std::string& filename) {
+		std::ifstream in(filename, std::ios::binary);
+		if (!in.is_open()) {
+			std::cout << "Failed to open file: " << filename << "\n";
+			return false;
+		}
+		SnapshotHeader h;
+		if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)) || memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+			|| h.version != SNAPSHOT_VERSION || h.width != WIDTH || h.height != HEIGHT
+			|| h.bucket_size != BUCKET_SIZE || h.n_buckets != n_buckets) {
+			std::cout << "Snapshot " << filename << " does not match this table (" << bytes() / (1 << 20) << " MB)\n";
+			return false;
+		}
+		if (!in.read(reinterpret_cast<char*>(buckets), bytes())) {
+			std::cout << "Snapshot " << filename << " is truncated\n";
+			clear();
+			return false;
 		}
-		else return 0;
+		generation.store(h.generation, std::memory_order_relaxed);
+		return true;
 	}
-};
\ No newline at end of file
+
+	void prefetch(board key) const {
+#if defined(_MSC_VER)
+		_mm_prefetch(reinterpret_cast<const char*>(&bucket(hash(key))), _MM_HINT_T0);
+#else
+		__builtin_prefetch(&bucket(hash(key)));
+#endif
+	}
+
+	// Store bounds of the score of a position with 'depth' moves played (NO_LOWER or NO_UPPER if unknown), and the column
+	// of its best move in the canonical orientation (NO_MOVE if unknown). If the position is already in the table, its
+	// bounds are merged with the stored ones, and the stored move is kept if 'move' is NO_MOVE.
+	// Otherwise replaces, in order of preference: an empty entry, an entry from a previous search, and finally the entry
+	// with the most moves played (the one with the smallest subtree).
+	Store put(board key, int lower, int upper, int move, int depth) {
+		uint64_t h = hash(key);
+		Bucket& b = bucket(h);
+		uint8_t gen = generation.load(std::memory_order_relaxed) & 0x3F;
+
+		int victim = 0;
+		int victim_priority = INT32_MAX;
+		Store result = Store::Replace;
+		for (int i = 0; i < BUCKET_SIZE; i++) {
+			uint64_t e = b.entries[i].load(std::memory_order_relaxed);
+			if (e == 0 || entry_key(e) == check(h)) {
+				victim = i;
+				result = e == 0 ? Store::Empty : Store::Update;
+				// bounds that disagree can only come from a hash collision (boards of more than 49 bits): keep the new ones
+				if (e != 0 && std::max(lower, entry_lower(e)) <= std::min(upper, entry_upper(e))) {
+					lower = std::max(lower, entry_lower(e));
+					upper = std::min(upper, entry_upper(e));
+					if (move == NO_MOVE) move = entry_move(e);
+				}
+				break;
+			}
+			int priority = (entry_generation(e) == gen ? 256 : 0) - entry_depth(e);
+			if (priority < victim_priority) {
+				victim = i;
+				victim_priority = priority;
+			}
+		}
+		uint64_t new_entry = (uint64_t)check(h) << 32 | (uint64_t)(move + 1) << 28 | (uint64_t)gen << 22 | (uint64_t)depth << 16
+			| (uint64_t)(lower + BOUND_OFFSET) << 8 | (upper == NO_UPPER ? 0 : (uint64_t)(upper + BOUND_OFFSET));
+		b.entries[victim].store(new_entry, std::memory_order_relaxed);
+		return result;
+	}
+
+	// Returns false if the position is not in the table
+	bool get(board key, Entry& entry) const {
+		uint64_t h = hash(key);
+		const Bucket& b = bucket(h);
+		for (int i = 0; i < BUCKET_SIZE; i++) {
+			uint64_t e = b.entries[i].load(std::memory_order_relaxed);
+			if (e != 0 && entry_key(e) == check(h)) {
+				entry.lower = entry_lower(e);
+				entry.upper = entry_upper(e);
+				entry.move = entry_move(e);
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+typedef BasicTranspositionTable<Position::WIDTH, Position::HEIGHT> TranspositionTable;
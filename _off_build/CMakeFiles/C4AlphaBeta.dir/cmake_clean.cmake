@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "C4AlphaBeta"
+  "C4AlphaBeta.pdb"
+  "CMakeFiles/C4AlphaBeta.dir/main.cpp.o"
+  "CMakeFiles/C4AlphaBeta.dir/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/C4AlphaBeta.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "C4Bench"
+  "C4Bench.pdb"
+  "CMakeFiles/C4Bench.dir/bench.cpp.o"
+  "CMakeFiles/C4Bench.dir/bench.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/C4Bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,29 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/AsyncSolver.cpp" "CMakeFiles/C4Solver.dir/AsyncSolver.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/AsyncSolver.cpp.o.d"
+  "/root/repo/BatchSolver.cpp" "CMakeFiles/C4Solver.dir/BatchSolver.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/BatchSolver.cpp.o.d"
+  "/root/repo/Benchmark.cpp" "CMakeFiles/C4Solver.dir/Benchmark.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/Benchmark.cpp.o.d"
+  "/root/repo/Corpus.cpp" "CMakeFiles/C4Solver.dir/Corpus.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/Corpus.cpp.o.d"
+  "/root/repo/Dfpn.cpp" "CMakeFiles/C4Solver.dir/Dfpn.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/Dfpn.cpp.o.d"
+  "/root/repo/EndgameTable.cpp" "CMakeFiles/C4Solver.dir/EndgameTable.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/EndgameTable.cpp.o.d"
+  "/root/repo/LazySMP.cpp" "CMakeFiles/C4Solver.dir/LazySMP.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/LazySMP.cpp.o.d"
+  "/root/repo/OpeningBook.cpp" "CMakeFiles/C4Solver.dir/OpeningBook.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/OpeningBook.cpp.o.d"
+  "/root/repo/Solver.cpp" "CMakeFiles/C4Solver.dir/Solver.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/Solver.cpp.o.d"
+  "/root/repo/SolverServer.cpp" "CMakeFiles/C4Solver.dir/SolverServer.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/SolverServer.cpp.o.d"
+  "/root/repo/SplitSolver.cpp" "CMakeFiles/C4Solver.dir/SplitSolver.cpp.o" "gcc" "CMakeFiles/C4Solver.dir/SplitSolver.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
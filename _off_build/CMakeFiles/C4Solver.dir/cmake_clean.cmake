@@ -0,0 +1,31 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/C4Solver.dir/AsyncSolver.cpp.o"
+  "CMakeFiles/C4Solver.dir/AsyncSolver.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/BatchSolver.cpp.o"
+  "CMakeFiles/C4Solver.dir/BatchSolver.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/Benchmark.cpp.o"
+  "CMakeFiles/C4Solver.dir/Benchmark.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/Corpus.cpp.o"
+  "CMakeFiles/C4Solver.dir/Corpus.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/Dfpn.cpp.o"
+  "CMakeFiles/C4Solver.dir/Dfpn.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/EndgameTable.cpp.o"
+  "CMakeFiles/C4Solver.dir/EndgameTable.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/LazySMP.cpp.o"
+  "CMakeFiles/C4Solver.dir/LazySMP.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/OpeningBook.cpp.o"
+  "CMakeFiles/C4Solver.dir/OpeningBook.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/Solver.cpp.o"
+  "CMakeFiles/C4Solver.dir/Solver.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/SolverServer.cpp.o"
+  "CMakeFiles/C4Solver.dir/SolverServer.cpp.o.d"
+  "CMakeFiles/C4Solver.dir/SplitSolver.cpp.o"
+  "CMakeFiles/C4Solver.dir/SplitSolver.cpp.o.d"
+  "libC4Solver.a"
+  "libC4Solver.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/C4Solver.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
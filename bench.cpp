@@ -0,0 +1,110 @@
+#include "Benchmark.hpp"
+#include "MoveScorer.hpp"
+
+namespace fs = std::filesystem;
+
+// Usage: C4Bench [options] [test_filenames...]      (all the files in Tests/ by default)
+// Options:
+//        --max-lines <n>       solve only the first n positions of each file
+//        --out <prefix>        write the reports to <prefix>.csv and <prefix>.json (default: bench)
+//        --baseline <file>     compare against the CSV report of a previous run; exits with 1 on regression
+//        --threshold <pct>     relative change counted as a regression (default: 10)
+//        --tt-mb <n>           memory budget of the transposition table, in megabytes
+//        --book <file>         opening book consulted before searching
+//        --endgame <file>      endgame table probed by the search
+//        --kernel <name>       move scoring kernel used by the search: scalar, avx2 or avx512 (default: best supported)
+//        --move-history <h>    move ordering learned from cutoffs: off (default), killers, history or both
+//        --persist-history     keep the learned move ordering from one position of a file to the next
+//        --search <s>          in-place (default): make and unmake moves on one position; copy: search copies of it
+//        --order <o>           file (default): solve the positions of a file in their order; prefix: grouped by shared prefix
+//        --move-scoring        run the microbenchmark of the move scoring kernels instead
+int main(int argc, char* argv[]) {
+	fs::path test_folder = "Tests";
+	Benchmark bench;
+	std::string out_prefix = "bench";
+	std::string baseline_file;
+	double threshold = 0.10;
+	bool move_scoring = false;
+
+	std::vector<std::string> filenames;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--max-lines" && i + 1 < argc) bench.max_lines = std::stoull(argv[++i]);
+		else if (arg == "--out" && i + 1 < argc) out_prefix = argv[++i];
+		else if (arg == "--baseline" && i + 1 < argc) baseline_file = argv[++i];
+		else if (arg == "--threshold" && i + 1 < argc) threshold = std::stod(argv[++i]) / 100;
+		else if (arg == "--tt-mb" && i + 1 < argc) TranspositionTable::default_bytes = std::stoull(argv[++i]) << 20;
+		else if (arg == "--book" && i + 1 < argc) {
+			auto book = std::make_shared<OpeningBook>();
+			if (!book->load(argv[++i])) return 1;
+			Solver::default_book = book;
+		}
+		else if (arg == "--endgame" && i + 1 < argc) {
+			auto endgame = std::make_shared<EndgameTable>();
+			if (!endgame->load(argv[++i])) return 1;
+			Solver::default_endgame = endgame;
+		}
+		else if (arg == "--kernel" && i + 1 < argc) {
+			std::string name = argv[++i];
+			MoveScorer::Kernel k = name == "avx512" ? MoveScorer::Kernel::AVX512 : name == "avx2" ? MoveScorer::Kernel::AVX2 : MoveScorer::Kernel::Scalar;
+			if (!MoveScorer::supported(k) || name != MoveScorer::name(k)) {
+				std::cout << "Unsupported kernel: " << name << "\n";
+				return 1;
+			}
+			MoveScorer::kernel = k;
+		}
+		else if (arg == "--move-history" && i + 1 < argc) {
+			std::string h = argv[++i];
+			if (h != "off" && h != "killers" && h != "history" && h != "both") {
+				std::cout << "Unknown move history: " << h << "\n";
+				return 1;
+			}
+			bench.use_killers = h == "killers" || h == "both";
+			bench.use_history = h == "history" || h == "both";
+		}
+		else if (arg == "--persist-history") bench.persist_history = true;
+		else if (arg == "--search" && i + 1 < argc) {
+			std::string search = argv[++i];
+			if (search != "in-place" && search != "copy") {
+				std::cout << "Unknown search: " << search << "\n";
+				return 1;
+			}
+			bench.make_unmake = search == "in-place";
+		}
+		else if (arg == "--order" && i + 1 < argc) {
+			std::string order = argv[++i];
+			if (order != "file" && order != "prefix") {
+				std::cout << "Unknown order: " << order << "\n";
+				return 1;
+			}
+			bench.prefix_order = order == "prefix";
+		}
+		else if (arg == "--move-scoring") move_scoring = true;
+		else filenames.push_back((test_folder / arg).string());
+	}
+	if (filenames.empty())
+		for (std::string f : { "Test_L3_R1", "Test_L2_R1", "Test_L2_R2", "Test_L1_R1", "Test_L1_R2", "Test_L1_R3" })
+			filenames.push_back((test_folder / f).string());
+
+	if (move_scoring) {
+		Benchmark::move_scoring(filenames, std::cout);
+		return 0;
+	}
+
+	for (const std::string& f : filenames) {
+		if (!bench.run_file(f)) return 1;
+		std::cout << "." << std::flush;
+	}
+	std::cout << "\n";
+	bench.print(std::cout);
+	bench.write_csv(out_prefix + ".csv");
+	bench.write_json(out_prefix + ".json");
+
+	if (!baseline_file.empty()) {
+		std::vector<Benchmark::LevelReport> baseline;
+		if (!Benchmark::read_csv(baseline_file, baseline)) return 1;
+		std::cout << "\nChange against " << baseline_file << ":\n";
+		if (bench.compare(baseline, threshold, std::cout)) return 1;
+	}
+	return 0;
+}
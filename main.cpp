@@ -1,12 +1,203 @@
 ﻿#include "Solver.hpp"
+#include "BatchSolver.hpp"
+#include "LazySMP.hpp"
+#include "SolverServer.hpp"
+#include "AsyncSolver.hpp"
+#include "SplitSolver.hpp"
+#include "Dfpn.hpp"
+#include "Corpus.hpp"
+#include "Benchmark.hpp"
 
 namespace fs = std::filesystem;
 
-int main() {
-	Solver S;
+// Solve positions (moves indexed from '1') on a WIDTH x HEIGHT board, one line per position: moves score nodes seconds
+template<int WIDTH, int HEIGHT>
+void solve_positions(const std::vector<std::string>& positions, std::ostream& strm) {
+	BasicSolver<WIDTH, HEIGHT> S;
+	for (const std::string& moves : positions) {
+		typename BasicSolver<WIDTH, HEIGHT>::Position P;
+		if (!P.play_moves_checked(moves)) {
+			strm << moves << " error\n";
+			continue;
+		}
+		unsigned long long nodes_before = S.nodeCount;
+		auto t1 = std::chrono::steady_clock::now();
+		int score = S.solve(P);
+		strm << moves << " " << score << " " << S.nodeCount - nodes_before << " "
+			 << std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count() << std::endl;
+	}
+}
 
+// Usage: C4AlphaBeta [options] [test_filename] [n_threads]
+//        C4AlphaBeta [options] smp [test_filename] [max_threads]
+//        C4AlphaBeta [options] split [test_filename] [n_workers] [split_depth] [max_lines]  solve on worker processes
+//        C4AlphaBeta [options] book <output_file> <depth> [n_threads] [root_moves]
+//        C4AlphaBeta [options] endgame <output_file> <empty_cells> <max_lines> [test_filenames...]
+//        C4AlphaBeta [options] warm <snapshot_file> [test_filenames...]
+//        C4AlphaBeta [options] analyze [test_filename] [max_lines]   score every column, against one solve per column
+//        C4AlphaBeta [options] weak [max_lines] [test_filenames...]   win/draw/loss against the exact score, on every test file by default
+//        C4AlphaBeta [options] budget [test_filename] [max_ms] [max_nodes]  solve each position within a budget (0 for none)
+//        C4AlphaBeta [options] dfpn [test_filename] [max_lines]  win or not: proof-number search against alpha_beta
+//        C4AlphaBeta [options] corpus <output_prefix> [count] [seed] [n_threads]  random test files, by level and rating
+//        C4AlphaBeta [options] async [test_filename] [cancel_after_ms] [n_workers]  cancel slow solves, then check the table
+//        C4AlphaBeta [options] serve [n_workers] [socket_path]      (reads requests from stdin without a socket path)
+//        C4AlphaBeta loadgen <socket_path> [test_filename] [n_clients] [n_requests]
+//        C4AlphaBeta [options] size <width>x<height> <moves...>     solve positions on another board size (7x6, 8x7, 9x7)
+// Options:
+//        --tt-mb <n>     memory budget of each transposition table, in megabytes
+//        --dfpn-mb <n>   memory budget of each proof-number table (dfpn, and 'win' requests of serve), in megabytes
+//        --dfpn-nodes <n>  nodes a 'win' request of serve may search before it is answered with 'unknown' (default 10^7)
+//        --huge-pages    back the transposition tables with huge pages when the system allows it
+//        --book <file>   opening book consulted before searching
+//        --endgame <file>  endgame table probed by the search
+//        --tt-snapshot <file>  load the transposition table from this file at startup (if it exists) and save it on exit
+//        --batch-order prefix  solve the lines of a test file grouped by shared prefix rather than in file order (output in file order)
+int main(int argc, char* argv[]) {
 	fs::path test_folder = "Tests";
-	std::string test_filename = "Test_L2_R2";
+
+	std::string snapshot;
+	bool prefix_order = false;
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--tt-mb" && i + 1 < argc) TranspositionTable::default_bytes = std::stoull(argv[++i]) << 20;
+		else if (arg == "--dfpn-mb" && i + 1 < argc) DfpnSolver::default_bytes = std::stoull(argv[++i]) << 20;
+		else if (arg == "--dfpn-nodes" && i + 1 < argc) SolverServer::dfpn_nodes = std::stoull(argv[++i]);
+		else if (arg == "--huge-pages") TranspositionTable::default_huge_pages = true;
+		else if (arg == "--tt-snapshot" && i + 1 < argc) snapshot = argv[++i];
+		else if (arg == "--batch-order" && i + 1 < argc) prefix_order = std::string(argv[++i]) == "prefix";
+		else if (arg == "--book" && i + 1 < argc) {
+			auto book = std::make_shared<OpeningBook>();
+			if (!book->load(argv[++i])) return 1;
+			Solver::default_book = book;
+		}
+		else if (arg == "--endgame" && i + 1 < argc) {
+			auto endgame = std::make_shared<EndgameTable>();
+			if (!endgame->load(argv[++i])) return 1;
+			Solver::default_endgame = endgame;
+		}
+		else args.push_back(arg);
+	}
+
+	if (args.size() > 0 && args[0] == "smp") {
+		std::string test_filename = args.size() > 1 ? args[1] : "Test_L2_R2";
+		unsigned int max_threads = args.size() > 2 ? std::stoi(args[2]) : 16;
+		LazySMPSolver::benchmark(test_folder.append(test_filename).string(), max_threads, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 0 && args[0] == "split") {
+		std::string test_filename = args.size() > 1 ? args[1] : "Test_L1_R3";
+		unsigned int n_workers = args.size() > 2 ? std::stoi(args[2]) : std::thread::hardware_concurrency();
+		int split_depth = args.size() > 3 ? std::stoi(args[3]) : 4;
+		size_t max_lines = args.size() > 4 ? std::stoull(args[4]) : 0;
+		SplitSolver::benchmark((test_folder / test_filename).string(), n_workers, split_depth, max_lines, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 2 && args[0] == "book") {
+		unsigned int n_threads = args.size() > 3 ? std::stoi(args[3]) : std::thread::hardware_concurrency();
+		return OpeningBook::generate(args[1], std::stoi(args[2]), n_threads, std::cout, args.size() > 4 ? args[4] : "") ? 0 : 1;
+	}
+
+	if (args.size() > 3 && args[0] == "endgame") {
+		std::vector<std::string> filenames;
+		for (size_t i = 4; i < args.size(); i++) filenames.push_back((test_folder / args[i]).string());
+		if (filenames.empty())
+			for (std::string f : { "Test_L3_R1", "Test_L2_R1", "Test_L2_R2", "Test_L1_R1" }) filenames.push_back((test_folder / f).string());
+		return EndgameTable::generate(args[1], std::stoi(args[2]), filenames, std::stoull(args[3]), std::cout) ? 0 : 1;
+	}
+
+	if (args.size() > 1 && args[0] == "warm") {
+		std::vector<std::string> filenames;
+		for (size_t i = 2; i < args.size(); i++) filenames.push_back((test_folder / args[i]).string());
+		if (filenames.empty())
+			for (std::string f : { "Test_L3_R1", "Test_L2_R1", "Test_L2_R2", "Test_L1_R1" }) filenames.push_back((test_folder / f).string());
+		Benchmark::warm_start(filenames, args[1], std::cout);
+		return 0;
+	}
+
+	if (args.size() > 0 && args[0] == "analyze") {
+		std::string test_filename = args.size() > 1 ? args[1] : "Test_L2_R2";
+		size_t max_lines = args.size() > 2 ? std::stoull(args[2]) : 0;
+		Benchmark::analyze((test_folder / test_filename).string(), max_lines, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 0 && args[0] == "weak") {
+		size_t max_lines = args.size() > 1 ? std::stoull(args[1]) : 0;
+		std::vector<std::string> filenames(args.begin() + std::min<size_t>(args.size(), 2), args.end());
+		if (filenames.empty()) filenames = { "Test_L3_R1", "Test_L2_R1", "Test_L2_R2", "Test_L1_R1", "Test_L1_R2", "Test_L1_R3" };
+		for (const std::string& f : filenames) {
+			std::cout << "== " << f << "\n";
+			Benchmark::weak((test_folder / f).string(), max_lines, std::cout);
+		}
+		return 0;
+	}
+
+	if (args.size() > 0 && args[0] == "budget") {
+		std::string test_filename = args.size() > 1 ? args[1] : "Test_L1_R2";
+		std::chrono::milliseconds max_time(args.size() > 2 ? std::stoll(args[2]) : 10);
+		unsigned long long max_nodes = args.size() > 3 ? std::stoull(args[3]) : 0;
+		Benchmark::budget((test_folder / test_filename).string(), max_nodes, max_time, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 1 && args[0] == "corpus") {
+		size_t count = args.size() > 2 ? std::stoull(args[2]) : 1000;
+		uint64_t seed = args.size() > 3 ? std::stoull(args[3]) : 0;
+		unsigned int n_threads = args.size() > 4 ? std::stoi(args[4]) : std::thread::hardware_concurrency();
+		CorpusGenerator generator(count, seed, n_threads);
+		return generator.generate(args[1], std::cout) ? 0 : 1;
+	}
+
+	if (args.size() > 0 && args[0] == "dfpn") {
+		std::string test_filename = args.size() > 1 ? args[1] : "Test_L2_R2";
+		size_t max_lines = args.size() > 2 ? std::stoull(args[2]) : 0;
+		Benchmark::dfpn((test_folder / test_filename).string(), max_lines, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 0 && args[0] == "async") {
+		std::string test_filename = args.size() > 1 ? args[1] : "Test_L1_R2";
+		std::chrono::milliseconds cancel_after(args.size() > 2 ? std::stoll(args[2]) : 10);
+		unsigned int n_workers = args.size() > 3 ? std::stoi(args[3]) : std::thread::hardware_concurrency();
+		AsyncSolver::cancel_test((test_folder / test_filename).string(), n_workers, cancel_after, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 0 && args[0] == "serve") {
+		unsigned int n_workers = args.size() > 1 ? std::stoi(args[1]) : std::thread::hardware_concurrency();
+		SolverServer server(n_workers);
+		if (args.size() > 2) return server.serve_socket(args[2]) ? 0 : 1;
+		server.serve_stream(std::cin, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 1 && args[0] == "loadgen") {
+		std::string test_filename = args.size() > 2 ? args[2] : "Test_L2_R1";
+		unsigned int n_clients = args.size() > 3 ? std::stoi(args[3]) : 8;
+		size_t n_requests = args.size() > 4 ? std::stoull(args[4]) : 0;
+		SolverServer::load_test(args[1], (test_folder / test_filename).string(), n_clients, n_requests, std::cout);
+		return 0;
+	}
+
+	if (args.size() > 2 && args[0] == "size") {
+		std::vector<std::string> positions(args.begin() + 2, args.end());
+		if (args[1] == "7x6") solve_positions<7, 6>(positions, std::cout);
+		else if (args[1] == "8x7") solve_positions<8, 7>(positions, std::cout);
+#if defined(__SIZEOF_INT128__)
+		else if (args[1] == "9x7") solve_positions<9, 7>(positions, std::cout);
+#endif
+		else {
+			std::cout << "Unsupported board size: " << args[1] << "\n";
+			return 1;
+		}
+		return 0;
+	}
+
+	std::string test_filename = args.size() > 0 ? args[0] : "Test_L2_R2";
+	unsigned int n_threads = args.size() > 1 ? std::stoi(args[1]) : 1;
 	
 	// Prepare output file for results of solution
 	std::time_t t = std::time(nullptr);
@@ -15,5 +206,16 @@ int main() {
 	
 	std::ofstream strm( std::string(dt_str) + "_" + test_filename + ".csv");
 	std::string test_file_str = test_folder.append(test_filename).string();
-	S.test_file(test_file_str, std::cout);
+	if (n_threads > 1 || prefix_order) {
+		BatchSolver B(n_threads);
+		if (fs::exists(snapshot)) B.snapshot = snapshot;
+		B.prefix_order = prefix_order;
+		B.test_file(test_file_str, strm);
+	}
+	else {
+		Solver S;
+		if (fs::exists(snapshot)) S.T->load(snapshot);
+		S.test_file(test_file_str, strm);
+		if (!snapshot.empty()) S.T->save(snapshot);
+	}
 	}
\ No newline at end of file